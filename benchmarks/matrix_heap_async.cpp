@@ -0,0 +1,88 @@
+#include "../src/multiply_async.hpp"
+#include "perf_counters.hpp"
+#include <benchmark/benchmark.h>
+
+// Each benchmark thread is one client issuing blocking requests, so the
+// per-iteration time is request latency and items/s is total throughput.
+// Both variants run the kernel the service uses for the backend, so the
+// gap between them is the effect of coalescing alone. The CUDA backends
+// run on the CPU when no GPU is present; the label names the backend used.
+// The async variant reports no perf counters: they only follow the client
+// thread, while the work runs on the service's threads.
+
+static MultiplyBackend effective_backend(MultiplyBackend backend) {
+  return backend != MultiplyBackend::CPU && !cudaDeviceAvailable()
+             ? MultiplyBackend::CPU
+             : backend;
+}
+
+static void BM_MatrixHeapMultiplySyncClients(benchmark::State &state) {
+  const size_t size = static_cast<size_t>(state.range(0));
+  const auto backend =
+      effective_backend(static_cast<MultiplyBackend>(state.range(1)));
+  state.SetLabel(to_string(backend));
+  const auto A = MatrixHeap<int32_t>::generate_random(size, -100, 100);
+  const auto B = MatrixHeap<int32_t>::generate_random(size, -100, 100);
+
+  PerfCounters perf;
+  perf.start();
+  for (auto _ : state) {
+    MatrixHeap<int32_t> result(size);
+    switch (backend) {
+    case MultiplyBackend::CUDA:
+      matrixMultiplyCUDA(A.data(), B.data(), result.data(), size);
+      break;
+    case MultiplyBackend::CUDA_RNS:
+      rnsMatrixMultiply(A.data(), B.data(), result.data(), size);
+      break;
+    case MultiplyBackend::CPU:
+      multiplyRowsCPU(A.data(), B.data(), result.data(), size, 0, size);
+      break;
+    }
+    benchmark::DoNotOptimize(result);
+  }
+  perf.stop();
+  perf.report(state);
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_MatrixHeapMultiplyAsyncClients(benchmark::State &state) {
+  const size_t size = static_cast<size_t>(state.range(0));
+  auto &service =
+      shared_multiply_service(static_cast<MultiplyBackend>(state.range(1)));
+  state.SetLabel(to_string(service.backend()));
+  const auto A = MatrixHeap<int32_t>::generate_random(size, -100, 100);
+  const auto B = MatrixHeap<int32_t>::generate_random(size, -100, 100);
+
+  for (auto _ : state) {
+    auto result = service.submit(A, B).get();
+    benchmark::DoNotOptimize(result);
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_MatrixHeapMultiplySyncClients)
+    ->ArgNames({"N", "backend"})
+    ->ArgsProduct({{16, 64},
+                   {static_cast<int>(MultiplyBackend::CPU),
+                    static_cast<int>(MultiplyBackend::CUDA),
+                    static_cast<int>(MultiplyBackend::CUDA_RNS)}})
+    ->Threads(1)
+    ->Threads(4)
+    ->Threads(16)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+BENCHMARK(BM_MatrixHeapMultiplyAsyncClients)
+    ->ArgNames({"N", "backend"})
+    ->ArgsProduct({{16, 64},
+                   {static_cast<int>(MultiplyBackend::CPU),
+                    static_cast<int>(MultiplyBackend::CUDA),
+                    static_cast<int>(MultiplyBackend::CUDA_RNS)}})
+    ->Threads(1)
+    ->Threads(4)
+    ->Threads(16)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
@@ -1,4 +1,5 @@
 #include "../src/matrix_heap.hpp"
+#include "perf_counters.hpp"
 #include <benchmark/benchmark.h>
 
 static void BM_MatrixHeapMultiplication(benchmark::State &state) {
@@ -6,10 +7,14 @@ static void BM_MatrixHeapMultiplication(benchmark::State &state) {
   const auto A = MatrixHeap<int>::generate_random(size, -100, 100);
   const auto B = MatrixHeap<int>::generate_random(size, -100, 100);
 
+  PerfCounters perf;
+  perf.start();
   for (auto _ : state) {
     auto result = A * B;
     benchmark::DoNotOptimize(result);
   }
+  perf.stop();
+  perf.report(state);
 
   state.SetComplexityN(state.range(0));
 }
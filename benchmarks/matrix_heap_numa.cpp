@@ -0,0 +1,65 @@
+#include "../src/matrix_numa.hpp"
+#include "perf_counters.hpp"
+#include <benchmark/benchmark.h>
+
+static void BM_MatrixHeapMultiplyNUMA(benchmark::State &state) {
+  const size_t size = static_cast<size_t>(state.range(0));
+  const auto A = MatrixHeap<int>::generate_random(size, -100, 100);
+  const auto B = MatrixHeap<int>::generate_random(size, -100, 100);
+
+  NumaOptions options;
+  options.placement = static_cast<NumaPlacement>(state.range(1));
+  state.SetLabel(to_string(options.placement));
+
+  PerfCounters perf;
+  perf.start();
+  for (auto _ : state) {
+    auto result = multiply_numa(A, B, options);
+    benchmark::DoNotOptimize(result);
+  }
+  perf.stop();
+  perf.report(state);
+}
+
+// Same multiply with the operands and result kept in placed buffers, so
+// only multiply() is timed: no topology scan, allocation or copies.
+static void BM_MatrixHeapMultiplyNUMAPlaced(benchmark::State &state) {
+  const size_t size = static_cast<size_t>(state.range(0));
+  const auto A = MatrixHeap<int>::generate_random(size, -100, 100);
+  const auto B = MatrixHeap<int>::generate_random(size, -100, 100);
+
+  NumaOptions options;
+  options.placement = static_cast<NumaPlacement>(state.range(1));
+  state.SetLabel(to_string(options.placement));
+
+  NumaMultiplier<int> numa(size, options);
+  std::copy(A.begin(), A.end(), numa.lhs());
+  std::copy(B.begin(), B.end(), numa.rhs());
+
+  PerfCounters perf;
+  perf.start();
+  for (auto _ : state) {
+    numa.multiply();
+    benchmark::DoNotOptimize(numa.result());
+  }
+  perf.stop();
+  perf.report(state);
+}
+
+BENCHMARK(BM_MatrixHeapMultiplyNUMA)
+    ->ArgNames({"N", "placement"})
+    ->ArgsProduct({{128, 256, 512, 1024},
+                   {static_cast<int>(NumaPlacement::Default),
+                    static_cast<int>(NumaPlacement::Local),
+                    static_cast<int>(NumaPlacement::Interleaved)}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK(BM_MatrixHeapMultiplyNUMAPlaced)
+    ->ArgNames({"N", "placement"})
+    ->ArgsProduct({{128, 256, 512, 1024},
+                   {static_cast<int>(NumaPlacement::Default),
+                    static_cast<int>(NumaPlacement::Local),
+                    static_cast<int>(NumaPlacement::Interleaved)}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
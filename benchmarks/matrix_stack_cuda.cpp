@@ -1,13 +1,18 @@
 #include "../src/matrix_stack.hpp"
+#include "perf_counters.hpp"
 #include <benchmark/benchmark.h>
 
 template <size_t N> void MatrixStackMultiplyCudaImpl(benchmark::State &state) {
   auto a = MatrixStack<N>::generate_random();
   auto b = MatrixStack<N>::generate_random();
+  PerfCounters perf;
+  perf.start();
   for (auto _ : state) {
     auto c = a.multiply_cuda(b);
     benchmark::DoNotOptimize(c);
   }
+  perf.stop();
+  perf.report(state);
   state.SetComplexityN(N);
 }
 
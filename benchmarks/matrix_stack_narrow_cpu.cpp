@@ -0,0 +1,79 @@
+#include "../src/matrix_stack.hpp"
+#include "perf_counters.hpp"
+#include <benchmark/benchmark.h>
+
+// Times multiplyRowsCPU directly. For int8/int16 this is what operator*
+// runs; the int32 instantiation is the baseline: the same i-k-j loop with
+// no widening.
+template <size_t N, typename T>
+void MatrixStackMultiplyNarrowImpl(benchmark::State &state) {
+  auto a = MatrixStack<N, T>::generate_random(-100, 100);
+  auto b = MatrixStack<N, T>::generate_random(-100, 100);
+  typename MatrixStack<N, T>::product_type c;
+  PerfCounters perf;
+  perf.start();
+  for (auto _ : state) {
+    multiplyRowsCPU(a.data(), b.data(), c.data(), N, 0, N);
+    benchmark::DoNotOptimize(c);
+  }
+  perf.stop();
+  perf.report(state);
+  state.SetComplexityN(N);
+}
+
+template <typename T>
+static void BM_MatrixStackMultiplyNarrow(benchmark::State &state) {
+  const auto N = state.range(0);
+  switch (N) {
+  case 10:
+    MatrixStackMultiplyNarrowImpl<10, T>(state);
+    break;
+  case 64:
+    MatrixStackMultiplyNarrowImpl<64, T>(state);
+    break;
+  case 100:
+    MatrixStackMultiplyNarrowImpl<100, T>(state);
+    break;
+  case 128:
+    MatrixStackMultiplyNarrowImpl<128, T>(state);
+    break;
+  case 256:
+    MatrixStackMultiplyNarrowImpl<256, T>(state);
+    break;
+  case 512:
+    MatrixStackMultiplyNarrowImpl<512, T>(state);
+    break;
+  default:
+    state.SkipWithError("Unsupported matrix size");
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_MatrixStackMultiplyNarrow, int32_t)
+    ->Unit(benchmark::kMillisecond)
+    ->Complexity(benchmark::oNCubed)
+    ->Arg(10)
+    ->Arg(64)
+    ->Arg(100)
+    ->Arg(128)
+    ->Arg(256)
+    ->Arg(512);
+
+BENCHMARK_TEMPLATE(BM_MatrixStackMultiplyNarrow, int8_t)
+    ->Unit(benchmark::kMillisecond)
+    ->Complexity(benchmark::oNCubed)
+    ->Arg(10)
+    ->Arg(64)
+    ->Arg(100)
+    ->Arg(128)
+    ->Arg(256)
+    ->Arg(512);
+
+BENCHMARK_TEMPLATE(BM_MatrixStackMultiplyNarrow, int16_t)
+    ->Unit(benchmark::kMillisecond)
+    ->Complexity(benchmark::oNCubed)
+    ->Arg(10)
+    ->Arg(64)
+    ->Arg(100)
+    ->Arg(128)
+    ->Arg(256)
+    ->Arg(512);
@@ -0,0 +1,205 @@
+#ifndef PERF_COUNTERS
+#define PERF_COUNTERS
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Hardware counters for the timed loop of a benchmark, read through
+// perf_event_open. Disabled unless RNS_PERF_COUNTERS is set. Events the
+// kernel refuses (containers, perf_event_paranoid, missing PMU) are
+// skipped, so with no permitted events the benchmark runs unchanged.
+//
+//   PerfCounters perf;
+//   perf.start();
+//   for (auto _ : state) { ... }
+//   perf.stop();
+//   perf.report(state);
+class PerfCounters {
+public:
+  PerfCounters() {
+    if (!std::getenv("RNS_PERF_COUNTERS"))
+      return;
+
+    open("cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    open("instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    open("l1d_misses", PERF_TYPE_HW_CACHE,
+         PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    open("llc_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    open("branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    if (uint64_t config = divider_event())
+      open("divider_cycles", PERF_TYPE_RAW, config);
+
+    if (events_.empty())
+      warn_unavailable();
+  }
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  ~PerfCounters() {
+    for (auto &event : events_)
+      close(event.fd);
+  }
+
+  void start() {
+    for (auto &event : events_) {
+      ioctl(event.fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(event.fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  void stop() {
+    for (auto &event : events_)
+      ioctl(event.fd, PERF_EVENT_IOC_DISABLE, 0);
+  }
+
+  // Adds each event as a per-iteration counter, plus IPC when both cycles
+  // and instructions were counted. Counters of multi-threaded benchmarks
+  // are summed over threads, so IPC is averaged to stay a per-thread ratio.
+  void report(benchmark::State &state) const {
+    double cycles = 0, instructions = 0;
+    for (const auto &event : events_) {
+      double value = 0;
+      if (!read_scaled(event.fd, value))
+        continue;
+      state.counters[event.name] =
+          benchmark::Counter(value, benchmark::Counter::kAvgIterations);
+      if (std::strcmp(event.name, "cycles") == 0)
+        cycles = value;
+      else if (std::strcmp(event.name, "instructions") == 0)
+        instructions = value;
+    }
+    if (cycles > 0 && instructions > 0)
+      state.counters["IPC"] = benchmark::Counter(
+          instructions / cycles, benchmark::Counter::kAvgThreads);
+  }
+
+private:
+  struct Event {
+    const char *name;
+    int fd;
+  };
+
+  void open(const char *name, uint32_t type, uint64_t config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd >= 0)
+      events_.push_back({name, static_cast<int>(fd)});
+    else
+      last_error_ = errno;
+  }
+
+  // Scales for multiplexing when more events are open than the PMU has
+  // counters.
+  static bool read_scaled(int fd, double &value) {
+    uint64_t data[3];
+    if (read(fd, data, sizeof(data)) != sizeof(data) || data[2] == 0)
+      return false;
+    value = static_cast<double>(data[0]) * data[1] / data[2];
+    return true;
+  }
+
+  // Raw encoding of "cycles with the divider busy" for this CPU, or 0 if
+  // none is known. The event and umask differ between Intel core
+  // generations and the same code means other events elsewhere, so only
+  // the listed family 6 models get it. cmask=1 counts cycles in which the
+  // divider is active rather than its occupancy. Hybrid parts are left
+  // out, since a raw event may be scheduled on their E-cores, which encode
+  // it differently.
+  static uint64_t divider_event() {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line, vendor;
+    int family = -1, model = -1;
+    // Fields of the first processor, which end at the first blank line.
+    while (std::getline(cpuinfo, line) && !line.empty()) {
+      const auto colon = line.find(':');
+      if (colon == std::string::npos)
+        continue;
+      std::string key = line.substr(0, colon);
+      key.erase(key.find_last_not_of(" \t") + 1);
+      const std::string value = line.substr(colon + 1);
+      if (key == "vendor_id")
+        vendor = value;
+      else if (key == "cpu family")
+        family = std::atoi(value.c_str());
+      else if (key == "model")
+        model = std::atoi(value.c_str());
+    }
+    if (vendor.find("GenuineIntel") == std::string::npos || family != 6)
+      return 0;
+
+    struct Encoding {
+      int model;
+      uint64_t event, umask;
+    };
+    static const Encoding encodings[] = {
+        // Skylake, Kaby/Coffee/Comet Lake, Skylake-X/Cascade/Cooper Lake:
+        // ARITH.DIVIDER_ACTIVE
+        {0x4E, 0x14, 0x01},
+        {0x5E, 0x14, 0x01},
+        {0x8E, 0x14, 0x01},
+        {0x9E, 0x14, 0x01},
+        {0xA5, 0x14, 0x01},
+        {0xA6, 0x14, 0x01},
+        {0x55, 0x14, 0x01},
+        // Ice Lake, Tiger Lake, Rocket Lake, Ice Lake-SP:
+        // ARITH.DIVIDER_ACTIVE
+        {0x7D, 0x14, 0x09},
+        {0x7E, 0x14, 0x09},
+        {0x8C, 0x14, 0x09},
+        {0x8D, 0x14, 0x09},
+        {0xA7, 0x14, 0x09},
+        {0x6A, 0x14, 0x09},
+        {0x6C, 0x14, 0x09},
+        // Sapphire Rapids, Emerald Rapids: ARITH.DIV_ACTIVE
+        {0x8F, 0xB0, 0x09},
+        {0xCF, 0xB0, 0x09},
+    };
+    for (const auto &encoding : encodings)
+      if (encoding.model == model)
+        return encoding.event | (encoding.umask << 8) | (1ULL << 24);
+    return 0;
+  }
+
+  void warn_unavailable() const {
+    // Benchmark threads construct their counters concurrently.
+    static std::atomic<bool> warned{false};
+    if (warned.exchange(true))
+      return;
+    std::cerr << "RNS_PERF_COUNTERS: no counters available ("
+              << std::strerror(last_error_)
+              << "), running without them. See "
+                 "/proc/sys/kernel/perf_event_paranoid\n";
+  }
+
+  std::vector<Event> events_;
+  int last_error_ = 0;
+};
+
+#endif // !PERF_COUNTERS
@@ -1,9 +1,32 @@
+#include <cstring>
 #include <iostream>
 #include <ostream>
 
 #include "matrix_stack.hpp"
+#include "multiply_auto.hpp"
+
+// `RNS-Tests tune [path]` measures the CPU variants and writes the tuning
+// file read by multiply_auto.
+static int tune(int argc, char *argv[]) {
+  const std::string path = argc > 2 ? argv[2] : tuning_file_path();
+  auto table = tune_multiply();
+  for (const auto &entry : table.entries())
+    std::cout << entry.n << ": " << to_string(entry.variant)
+              << " tile=" << entry.tile << " threads=" << entry.threads
+              << '\n';
+
+  if (!table.save(path)) {
+    std::cerr << "Failed to write " << path << std::endl;
+    return 1;
+  }
+  std::cout << "Saved to " << path << std::endl;
+  return 0;
+}
 
 int main(int argc, char *argv[]) {
+  if (argc > 1 && std::strcmp(argv[1], "tune") == 0)
+    return tune(argc, argv);
+
   MatrixStack<2> m{{2, 2}};
 
   for (auto const &el : m) {
@@ -4,10 +4,15 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <initializer_list>
+#include <limits>
 #include <random>
 #include <vector>
 
+#include "multiply_cpu.hpp"
+#include "multiply_int32.hpp"
+
 template <typename T> class MatrixHeap {
 public:
   MatrixHeap(size_t dim) : size_(dim), data_(dim * dim, 0) {}
@@ -58,29 +63,34 @@ public:
     return mat;
   }
 
-  static MatrixHeap generate_random(size_t n, T min = -10000, T max = 10000) {
+  // The default range is clamped to what T can hold.
+  static MatrixHeap generate_random(size_t n, T min = clamp_to_range(-10000),
+                                    T max = clamp_to_range(10000)) {
     assert(min <= max);
     MatrixHeap mat(n);
     std::random_device rd;
     std::mt19937 gen(rd());
-    std::uniform_int_distribution<T> dist(min, max);
+    // uniform_int_distribution is not defined for 8-bit types.
+    std::uniform_int_distribution<long long> dist(min, max);
 
     for (auto &elem : mat.data_)
-      elem = dist(gen);
+      elem = static_cast<T>(dist(gen));
 
     return mat;
   }
 
-  MatrixHeap<T> multiply_cuda(const MatrixHeap<T> &rhs) const {
-    MatrixHeap<T> result;
+  MatrixHeap<accumulator_t<T>> multiply_cuda(const MatrixHeap<T> &rhs) const {
+    assert(size_ == rhs.size_);
+    MatrixHeap<accumulator_t<T>> result(size_);
 
-    matrixMultiplyCUDA(data_.data(), rhs.data_.data(), result.data_.data(),
-                       size_);
+    matrixMultiplyCUDA(data_.data(), rhs.data_.data(), result.data(), size_);
 
     return result;
   }
 
   size_t size() const { return size_; }
+  T *data() { return data_.data(); }
+  const T *data() const { return data_.data(); }
 
   auto begin() { return data_.begin(); }
   auto end() { return data_.end(); }
@@ -90,6 +100,15 @@ public:
   auto cend() const { return data_.cend(); }
 
 private:
+  static constexpr T clamp_to_range(long long value) {
+    return static_cast<T>(
+        value < std::numeric_limits<T>::min()
+            ? std::numeric_limits<T>::min()
+            : (value > std::numeric_limits<T>::max()
+                   ? std::numeric_limits<T>::max()
+                   : value));
+  }
+
   size_t size_;
   std::vector<T> data_;
 };
@@ -104,24 +123,35 @@ inline MatrixHeap<T> operator-(MatrixHeap<T> lhs, const MatrixHeap<T> &rhs) {
   return lhs -= rhs;
 }
 
+// Products of int8/int16 matrices are int32 (see accumulator_t). Narrow
+// storage goes through multiplyRowsCPU, which widens with pmaddwd.
 template <typename T>
-MatrixHeap<T> operator*(const MatrixHeap<T> &lhs, const MatrixHeap<T> &rhs) {
+MatrixHeap<accumulator_t<T>> operator*(const MatrixHeap<T> &lhs,
+                                       const MatrixHeap<T> &rhs) {
   assert(lhs.size() == rhs.size());
+  using Acc = accumulator_t<T>;
   auto n = lhs.size();
 
-  MatrixHeap<T> result(n);
+  MatrixHeap<Acc> result(n);
+  if (sizeof(T) < sizeof(Acc)) {
+    multiplyRowsCPU(lhs.data(), rhs.data(), result.data(), n, 0, n);
+    return result;
+  }
+
   for (size_t i = 0; i < n; ++i)
     for (size_t j = 0; j < n; ++j) {
-      auto sum{0};
+      Acc sum{};
       for (size_t k = 0; k < n; ++k)
-        sum += lhs(i, k) * rhs(k, j);
+        sum += static_cast<Acc>(lhs(i, k)) * rhs(k, j);
       result(i, j) = sum;
     }
 
   return result;
 }
 
-template <typename T> MatrixHeap<T> operator*(T scalar, MatrixHeap<T> mat) {
+template <typename T>
+MatrixHeap<T> operator*(typename non_deduced<T>::type scalar,
+                        MatrixHeap<T> mat) {
   for (auto &el : mat) {
     el *= scalar;
   }
@@ -129,7 +159,9 @@ template <typename T> MatrixHeap<T> operator*(T scalar, MatrixHeap<T> mat) {
   return mat;
 }
 
-template <typename T> MatrixHeap<T> operator*(MatrixHeap<T> mat, T scalar) {
+template <typename T>
+MatrixHeap<T> operator*(MatrixHeap<T> mat,
+                        typename non_deduced<T>::type scalar) {
   return scalar * mat;
 }
 
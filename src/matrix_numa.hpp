@@ -0,0 +1,406 @@
+#ifndef MATRIX_NUMA
+#define MATRIX_NUMA
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "matrix_heap.hpp"
+#include "multiply_cpu.hpp"
+
+struct NumaNode {
+  int id;
+  std::vector<int> cpus;
+};
+
+// Parses a sysfs cpu list such as "0-3,8,10-11".
+inline std::vector<int> parse_cpu_list(const std::string &list) {
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty() || range == "\n")
+      continue;
+    int first = 0, last = 0;
+    char dash = 0;
+    std::stringstream rs(range);
+    rs >> first;
+    if (rs >> dash >> last)
+      assert(dash == '-' && "Malformed cpu list");
+    else
+      last = first;
+    for (int cpu = first; cpu <= last; ++cpu)
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+// CPUs the process may run on (cpuset/taskset limits). Empty if the
+// kernel does not report them.
+inline std::vector<int> allowed_cpus() {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) != 0)
+    return cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    if (CPU_ISSET(cpu, &set))
+      cpus.push_back(cpu);
+  return cpus;
+}
+
+// Reads the node layout from /sys/devices/system/node, keeping only CPUs
+// in the process affinity mask; nodes left without CPUs are dropped.
+// Machines without that directory, or with no usable CPUs on any node, are
+// reported as a single node holding every allowed CPU.
+inline std::vector<NumaNode> scan_numa_topology() {
+  std::vector<NumaNode> nodes;
+  const auto allowed = allowed_cpus();
+  auto is_allowed = [&allowed](int cpu) {
+    return allowed.empty() ||
+           std::binary_search(allowed.begin(), allowed.end(), cpu);
+  };
+
+  if (DIR *dir = opendir("/sys/devices/system/node")) {
+    while (dirent *entry = readdir(dir)) {
+      int id = 0;
+      char tail = 0;
+      if (std::sscanf(entry->d_name, "node%d%c", &id, &tail) != 1)
+        continue;
+
+      std::ifstream file("/sys/devices/system/node/" +
+                         std::string(entry->d_name) + "/cpulist");
+      std::string list;
+      std::getline(file, list);
+      auto cpus = parse_cpu_list(list);
+      cpus.erase(std::remove_if(cpus.begin(), cpus.end(),
+                                [&](int cpu) { return !is_allowed(cpu); }),
+                 cpus.end());
+      if (!cpus.empty())
+        nodes.push_back({id, std::move(cpus)});
+    }
+    closedir(dir);
+  }
+
+  if (nodes.empty()) {
+    NumaNode node{0, allowed};
+    if (node.cpus.empty()) {
+      unsigned count = std::max(1u, std::thread::hardware_concurrency());
+      for (unsigned cpu = 0; cpu < count; ++cpu)
+        node.cpus.push_back(static_cast<int>(cpu));
+    }
+    nodes.push_back(std::move(node));
+  }
+
+  std::sort(nodes.begin(), nodes.end(),
+            [](const NumaNode &a, const NumaNode &b) { return a.id < b.id; });
+  return nodes;
+}
+
+// Topology scanned once on first use, like tuning_table(). Affinity
+// changes made after that are not seen; scan_numa_topology() rereads it.
+inline const std::vector<NumaNode> &numa_topology() {
+  static const std::vector<NumaNode> nodes = scan_numa_topology();
+  return nodes;
+}
+
+// Restricts the calling thread to `cpus`. Returns false if the kernel
+// refused, in which case the thread keeps its previous affinity.
+inline bool pin_current_thread(const std::vector<int> &cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus)
+    if (cpu >= 0 && cpu < CPU_SETSIZE)
+      CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+enum class NumaPlacement {
+  Default,     // every page first-touched by the calling thread
+  Local,       // rows of A and C on the node that computes them, B per node
+  Interleaved, // pages of A, B and C spread round-robin across nodes
+};
+
+inline const char *to_string(NumaPlacement placement) {
+  switch (placement) {
+  case NumaPlacement::Default:
+    return "default";
+  case NumaPlacement::Local:
+    return "local";
+  case NumaPlacement::Interleaved:
+    return "interleaved";
+  }
+  return "unknown";
+}
+
+// Page-aligned, untouched storage. Physical pages are only placed when a
+// thread first writes them, so the placement is decided by who fills it.
+template <typename T> class NumaBuffer {
+public:
+  explicit NumaBuffer(size_t count) : count_(count), data_(nullptr) {
+    if (count_ == 0)
+      return;
+    void *ptr = mmap(nullptr, bytes(), PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED)
+      throw std::system_error(errno, std::generic_category(), "mmap");
+    data_ = static_cast<T *>(ptr);
+  }
+
+  NumaBuffer(NumaBuffer &&other) noexcept
+      : count_(other.count_), data_(other.data_) {
+    other.data_ = nullptr;
+    other.count_ = 0;
+  }
+
+  NumaBuffer(const NumaBuffer &) = delete;
+  NumaBuffer &operator=(const NumaBuffer &) = delete;
+  NumaBuffer &operator=(NumaBuffer &&) = delete;
+
+  ~NumaBuffer() {
+    if (data_)
+      munmap(data_, bytes());
+  }
+
+  // Asks the kernel to interleave pages over `nodes`. Must be called before
+  // the buffer is touched. Returns false where mbind is unavailable.
+  bool interleave(const std::vector<NumaNode> &nodes) {
+    if (!data_ || nodes.size() < 2)
+      return false;
+    unsigned long mask = 0;
+    for (const auto &node : nodes)
+      if (node.id >= 0 && node.id < static_cast<int>(sizeof(mask) * 8))
+        mask |= 1UL << node.id;
+    return syscall(SYS_mbind, data_, bytes(), MPOL_INTERLEAVE, &mask,
+                   sizeof(mask) * 8, 0) == 0;
+  }
+
+  T *data() { return data_; }
+  const T *data() const { return data_; }
+  size_t size() const { return count_; }
+
+private:
+  size_t bytes() const { return count_ * sizeof(T); }
+
+  size_t count_;
+  T *data_;
+};
+
+struct NumaOptions {
+  NumaPlacement placement = NumaPlacement::Local;
+  size_t threads = 0; // 0 uses every CPU the process may run on
+  size_t tile_rows = 16;
+};
+
+// Operands and result of repeated n x n multiplies with threads pinned per
+// NUMA node. Pages are placed once, when the buffers are created, and stay
+// put: writing operands through lhs()/rhs() and reading result() in place
+// keeps A and C rows on the node that computes them, and no multiply
+// copies them in or out.
+//
+// Rows of C are split into one contiguous range per node; each node's
+// threads take row tiles from their own range first and only then help
+// other nodes. B is prepared in the row kernel's layout on every
+// multiply(), with Local placement as one replica per node. On a
+// single-node machine all placements degrade to a pinned parallel
+// multiply.
+template <typename T> class NumaMultiplier {
+public:
+  using Acc = accumulator_t<T>;
+
+  explicit NumaMultiplier(size_t n, const NumaOptions &options = {})
+      : n_(n), options_(options), nodes_(numa_topology()),
+        pinned_(options.placement != NumaPlacement::Default),
+        local_(options.placement == NumaPlacement::Local),
+        row_begin_(nodes_.size() + 1), a_(n * n), rhs_(n * n), c_(n * n) {
+    assert(options_.tile_rows > 0);
+    const size_t node_count = nodes_.size();
+
+    size_t cpu_count = 0;
+    for (const auto &node : nodes_)
+      cpu_count += node.cpus.size();
+    // Pinned placements need at least one thread per node to place its rows.
+    thread_count_ = std::max(options_.threads ? options_.threads : cpu_count,
+                             pinned_ ? node_count : size_t{1});
+
+    for (size_t node = 0; node < (local_ ? node_count : 1); ++node)
+      b_.emplace_back(Operand::size(n));
+
+    if (options_.placement == NumaPlacement::Interleaved) {
+      a_.interleave(nodes_);
+      rhs_.interleave(nodes_);
+      b_.front().interleave(nodes_);
+      c_.interleave(nodes_);
+    }
+
+    // Row range [row_begin_[node], row_begin_[node + 1]) is owned by `node`.
+    for (size_t node = 0; node <= node_count; ++node)
+      row_begin_[node] = n * node / node_count;
+
+    // First touch: zeroing a page places it on the node of the thread
+    // doing it, so each node's first thread zeroes that node's rows.
+    auto place = [this](size_t home) {
+      const size_t first = row_begin_[home] * n_;
+      const size_t last = row_begin_[home + 1] * n_;
+      std::fill(a_.data() + first, a_.data() + last, T{});
+      std::fill(rhs_.data() + first, rhs_.data() + last, T{});
+      std::fill(c_.data() + first, c_.data() + last, Acc{});
+    };
+    if (!pinned_) {
+      for (size_t node = 0; node < node_count; ++node)
+        place(node);
+      std::fill(b_.front().data(), b_.front().data() + b_.front().size(),
+                typename Operand::type{});
+      return;
+    }
+    run(node_count, [&](size_t home) {
+      place(home);
+      if (local_)
+        std::fill(b_[home].data(), b_[home].data() + b_[home].size(),
+                  typename Operand::type{});
+      else
+        Operand::prepare(rhs_.data(), b_.front().data(), n_, home,
+                         node_count);
+    }, [](size_t) {});
+  }
+
+  size_t size() const { return n_; }
+
+  // Row-major n x n operands; written in place, read by multiply().
+  T *lhs() { return a_.data(); }
+  T *rhs() { return rhs_.data(); }
+
+  // Row-major n x n product of the last multiply().
+  const Acc *result() const { return c_.data(); }
+
+  void multiply() {
+    const size_t node_count = nodes_.size();
+    std::vector<std::atomic<size_t>> next_row(node_count);
+    for (size_t node = 0; node < node_count; ++node)
+      next_row[node] = row_begin_[node];
+
+    if (!pinned_)
+      Operand::prepare(rhs_.data(), b_.front().data(), n_);
+
+    auto prepare = [this, node_count](size_t home) {
+      if (!pinned_)
+        return;
+      if (local_)
+        Operand::prepare(rhs_.data(), b_[home].data(), n_);
+      else
+        Operand::prepare(rhs_.data(), b_.front().data(), n_, home,
+                         node_count);
+    };
+    auto compute = [&](size_t home) {
+      const auto *b = b_[local_ ? home : 0].data();
+      for (size_t step = 0; step < node_count; ++step) {
+        const size_t node = (home + step) % node_count;
+        const size_t end = row_begin_[node + 1];
+        for (;;) {
+          size_t row = next_row[node].fetch_add(options_.tile_rows);
+          if (row >= end)
+            break;
+          Operand::multiply(a_.data(), b, c_.data(), n_, row,
+                            std::min(row + options_.tile_rows, end));
+        }
+      }
+    };
+    run(thread_count_, prepare, compute);
+  }
+
+private:
+  using Operand = RowsOperand<T>;
+
+  // Runs `thread_count` threads assigned to nodes round-robin and, unless
+  // placement is Default, pinned there. The first thread of each node
+  // calls prepare(home); every thread then waits until all have done so
+  // and calls compute(home). If spawning fails partway, `expected` drops
+  // to the threads actually started so the barrier still opens, and
+  // `abandoned` makes them return without computing.
+  template <typename Prepare, typename Compute>
+  void run(size_t thread_count, Prepare prepare, Compute compute) {
+    const size_t node_count = nodes_.size();
+    std::atomic<size_t> placed{0};
+    std::atomic<size_t> expected{thread_count};
+    std::atomic<bool> abandoned{false};
+    auto worker = [&](size_t thread_index) {
+      const size_t home = thread_index % node_count;
+      if (pinned_)
+        pin_current_thread(nodes_[home].cpus);
+      if (thread_index < node_count)
+        prepare(home);
+      ++placed;
+      while (placed.load() < expected.load())
+        std::this_thread::yield();
+      if (!abandoned.load())
+        compute(home);
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count);
+    try {
+      for (size_t t = 0; t < thread_count; ++t)
+        threads.emplace_back(worker, t);
+    } catch (...) {
+      abandoned = true;
+      expected = threads.size();
+      for (auto &thread : threads)
+        thread.join();
+      throw;
+    }
+    for (auto &thread : threads)
+      thread.join();
+  }
+
+  size_t n_;
+  NumaOptions options_;
+  const std::vector<NumaNode> &nodes_;
+  bool pinned_;
+  bool local_;
+  size_t thread_count_;
+  std::vector<size_t> row_begin_;
+  NumaBuffer<T> a_;
+  // B as written by the caller; b_ holds it in the row kernel's layout.
+  NumaBuffer<T> rhs_;
+  std::vector<NumaBuffer<typename Operand::type>> b_;
+  NumaBuffer<Acc> c_;
+};
+
+// One-shot NumaMultiplier: copies the operands into freshly placed
+// buffers and the product out. Repeated multiplies of one size should
+// keep a NumaMultiplier instead.
+template <typename T>
+MatrixHeap<accumulator_t<T>> multiply_numa(const MatrixHeap<T> &lhs,
+                                           const MatrixHeap<T> &rhs,
+                                           const NumaOptions &options = {}) {
+  assert(lhs.size() == rhs.size());
+  const size_t n = lhs.size();
+
+  NumaMultiplier<T> numa(n, options);
+  std::copy(lhs.begin(), lhs.end(), numa.lhs());
+  std::copy(rhs.begin(), rhs.end(), numa.rhs());
+  numa.multiply();
+
+  MatrixHeap<accumulator_t<T>> result(n);
+  std::copy(numa.result(), numa.result() + n * n, result.begin());
+  return result;
+}
+
+#endif // !MATRIX_NUMA
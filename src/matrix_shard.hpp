@@ -0,0 +1,280 @@
+#ifndef MATRIX_SHARD
+#define MATRIX_SHARD
+
+#include <atomic>
+#include <chrono>
+#include <cassert>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "matrix_heap.hpp"
+#include "multiply_cpu.hpp"
+
+// One block of C = A * B. Shards are plain data so a coordinator can hand
+// them to local worker processes now and to remote nodes later.
+struct MatrixShard {
+  size_t row_begin;
+  size_t row_end;
+  size_t col_begin;
+  size_t col_end;
+  size_t attempt;
+};
+
+// Splits an N x N product into blocks of block_rows x block_cols.
+// block_cols == 0 gives full-width row shards.
+inline std::vector<MatrixShard> plan_shards(size_t n, size_t block_rows,
+                                            size_t block_cols = 0) {
+  assert(block_rows > 0 && "Shard height must be positive");
+  if (block_cols == 0)
+    block_cols = n;
+
+  std::vector<MatrixShard> shards;
+  for (size_t row = 0; row < n; row += block_rows)
+    for (size_t col = 0; col < n; col += block_cols)
+      shards.push_back({row, std::min(row + block_rows, n), col,
+                        std::min(col + block_cols, n), 0});
+  return shards;
+}
+
+// Operands and result of one product in a named POSIX shared memory object.
+// Layout: a 64-byte header holding N, then A, B and C as row-major N x N
+// int32_t blocks. The creating handle unlinks the object on destruction.
+class SharedMatrixRegion {
+public:
+  static constexpr size_t header_bytes = 64;
+
+  static SharedMatrixRegion create(const std::string &name, size_t n) {
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+      throw std::system_error(errno, std::generic_category(), "shm_open");
+
+    const size_t bytes = bytes_for(n);
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+      int err = errno;
+      close(fd);
+      shm_unlink(name.c_str());
+      throw std::system_error(err, std::generic_category(), "ftruncate");
+    }
+
+    SharedMatrixRegion region(name, fd, bytes, true);
+    *reinterpret_cast<uint64_t *>(region.base_) = n;
+    return region;
+  }
+
+  static SharedMatrixRegion open(const std::string &name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0)
+      throw std::system_error(errno, std::generic_category(), "shm_open");
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      int err = errno;
+      close(fd);
+      throw std::system_error(err, std::generic_category(), "fstat");
+    }
+
+    const size_t bytes = static_cast<size_t>(st.st_size);
+    if (bytes < header_bytes) {
+      close(fd);
+      throw std::runtime_error("Shared matrix region " + name +
+                               " is too small for its header");
+    }
+
+    SharedMatrixRegion region(name, fd, bytes, false);
+    const uint64_t n = region.size();
+    if (n > 0 && (bytes - header_bytes) / (3 * sizeof(int32_t)) / n < n)
+      throw std::runtime_error("Shared matrix region " + name +
+                               " is smaller than its header claims");
+    return region;
+  }
+
+  SharedMatrixRegion(SharedMatrixRegion &&other) noexcept
+      : name_(std::move(other.name_)), base_(other.base_),
+        bytes_(other.bytes_), owner_(other.owner_) {
+    other.base_ = nullptr;
+    other.owner_ = false;
+  }
+
+  SharedMatrixRegion(const SharedMatrixRegion &) = delete;
+  SharedMatrixRegion &operator=(const SharedMatrixRegion &) = delete;
+  SharedMatrixRegion &operator=(SharedMatrixRegion &&) = delete;
+
+  ~SharedMatrixRegion() {
+    if (base_)
+      munmap(base_, bytes_);
+    if (owner_)
+      shm_unlink(name_.c_str());
+  }
+
+  size_t size() const { return *reinterpret_cast<const uint64_t *>(base_); }
+  const std::string &name() const { return name_; }
+
+  int32_t *a() { return block(0); }
+  int32_t *b() { return block(1); }
+  int32_t *c() { return block(2); }
+  const int32_t *a() const { return block(0); }
+  const int32_t *b() const { return block(1); }
+  const int32_t *c() const { return block(2); }
+
+private:
+  SharedMatrixRegion(std::string name, int fd, size_t bytes, bool owner)
+      : name_(std::move(name)), base_(nullptr), bytes_(bytes), owner_(owner) {
+    void *ptr =
+        mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int err = errno;
+    close(fd);
+    if (ptr == MAP_FAILED) {
+      if (owner_)
+        shm_unlink(name_.c_str());
+      throw std::system_error(err, std::generic_category(), "mmap");
+    }
+    base_ = static_cast<char *>(ptr);
+  }
+
+  static size_t bytes_for(size_t n) {
+    return header_bytes + 3 * n * n * sizeof(int32_t);
+  }
+
+  int32_t *block(size_t index) const {
+    const size_t n = size();
+    return reinterpret_cast<int32_t *>(base_ + header_bytes) + index * n * n;
+  }
+
+  std::string name_;
+  char *base_;
+  size_t bytes_;
+  bool owner_;
+};
+
+// Kernel a worker runs on its shard. It must only write the shard's block
+// of C.
+using ShardKernel = std::function<void(const int32_t *A, const int32_t *B,
+                                       int32_t *C, size_t N,
+                                       const MatrixShard &shard)>;
+
+inline void multiply_shard_cpu(const int32_t *A, const int32_t *B, int32_t *C,
+                               size_t N, const MatrixShard &shard) {
+  multiplyBlockCPU(A, B, C, N, shard.row_begin, shard.row_end,
+                   shard.col_begin, shard.col_end);
+}
+
+struct ShardedMultiplyOptions {
+  size_t workers = 4;
+  size_t block_rows = 64;
+  size_t block_cols = 0;
+  size_t max_attempts = 3;
+};
+
+// Coordinator: computes C in `region` by forking up to options.workers
+// worker processes, one per shard. A shard whose worker crashes or exits
+// non-zero is dispatched again until it has been tried max_attempts times.
+// Only the coordinator's own workers are reaped, so other children of the
+// process (or a concurrent coordinator) keep their exit status.
+inline void multiply_sharded(SharedMatrixRegion &region,
+                             const ShardedMultiplyOptions &options,
+                             const ShardKernel &kernel = multiply_shard_cpu) {
+  assert(options.workers > 0 && options.max_attempts > 0);
+
+  const size_t n = region.size();
+  auto plan = plan_shards(n, options.block_rows, options.block_cols);
+  std::deque<MatrixShard> pending(plan.begin(), plan.end());
+  std::map<pid_t, MatrixShard> running;
+
+  auto stop_workers = [&running]() {
+    for (auto &worker : running)
+      kill(worker.first, SIGKILL);
+    for (auto &worker : running)
+      waitpid(worker.first, nullptr, 0);
+  };
+
+  while (!pending.empty() || !running.empty()) {
+    while (!pending.empty() && running.size() < options.workers) {
+      MatrixShard shard = pending.front();
+      pending.pop_front();
+
+      pid_t pid = fork();
+      if (pid < 0) {
+        int err = errno;
+        stop_workers();
+        throw std::system_error(err, std::generic_category(), "fork");
+      }
+      if (pid == 0) {
+        try {
+          kernel(region.a(), region.b(), region.c(), n, shard);
+        } catch (...) {
+          _exit(1);
+        }
+        _exit(0);
+      }
+      running.emplace(pid, shard);
+    }
+
+    int status = 0;
+    auto it = running.begin();
+    for (; it != running.end(); ++it) {
+      pid_t pid = waitpid(it->first, &status, WNOHANG);
+      if (pid == it->first)
+        break;
+      if (pid < 0 && errno != EINTR) {
+        int err = errno;
+        stop_workers();
+        throw std::system_error(err, std::generic_category(), "waitpid");
+      }
+    }
+    if (it == running.end()) {
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      continue;
+    }
+
+    MatrixShard shard = it->second;
+    running.erase(it);
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+      continue;
+
+    if (++shard.attempt >= options.max_attempts) {
+      stop_workers();
+      throw std::runtime_error("Shard failed after " +
+                               std::to_string(options.max_attempts) +
+                               " attempts");
+    }
+    pending.push_back(shard);
+  }
+}
+
+inline MatrixHeap<int32_t>
+multiply_sharded(const MatrixHeap<int32_t> &lhs, const MatrixHeap<int32_t> &rhs,
+                 const ShardedMultiplyOptions &options = {},
+                 const ShardKernel &kernel = multiply_shard_cpu) {
+  assert(lhs.size() == rhs.size());
+  static std::atomic<unsigned> counter{0};
+
+  const size_t n = lhs.size();
+  const std::string name = "/rns-multiply-" + std::to_string(getpid()) + "-" +
+                           std::to_string(counter++);
+  auto region = SharedMatrixRegion::create(name, n);
+  std::copy(lhs.begin(), lhs.end(), region.a());
+  std::copy(rhs.begin(), rhs.end(), region.b());
+
+  multiply_sharded(region, options, kernel);
+
+  MatrixHeap<int32_t> result(n);
+  std::copy(region.c(), region.c() + n * n, result.begin());
+  return result;
+}
+
+#endif // !MATRIX_SHARD
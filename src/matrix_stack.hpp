@@ -3,31 +3,41 @@
 
 #include <algorithm>
 #include <array>
+#include <cmath>
 #include <cassert>
 #include <cstdint>
 #include <initializer_list>
+#include <limits>
 #include <random>
 
+#include "multiply_cpu.hpp"
 #include "multiply_int32.hpp"
 
-template <size_t N> class MatrixStack {
+// T is the storage type. int8_t and int16_t operands are multiplied with
+// int32_t accumulation, so products of narrow matrices are MatrixStack<N,
+// int32_t>.
+template <size_t N, typename T = int32_t> class MatrixStack {
 public:
+  using value_type = T;
+  using product_type = MatrixStack<N, accumulator_t<T>>;
+
   MatrixStack();
-  explicit MatrixStack(std::initializer_list<int32_t> init);
+  explicit MatrixStack(std::initializer_list<T> init);
 
-  int32_t &operator()(size_t row, size_t col);
-  const int32_t &operator()(size_t row, size_t col) const;
+  T &operator()(size_t row, size_t col);
+  const T &operator()(size_t row, size_t col) const;
 
   MatrixStack &operator+=(const MatrixStack &rhs);
   MatrixStack &operator-=(const MatrixStack &rhs);
 
   MatrixStack transpose() const;
   static MatrixStack create_identity();
-  static MatrixStack generate_random(int32_t min = -10'000,
-                                     int32_t max = 10'000);
+  // The default range is clamped to what T can hold.
+  static MatrixStack generate_random(T min = clamp_to_range(-10'000),
+                                     T max = clamp_to_range(10'000));
 
-  MatrixStack<N> multiply_cuda(const MatrixStack<N> &rhs) const;
-  MatrixStack<N> multiply_cuda_rns(const MatrixStack<N> &rhs) const;
+  product_type multiply_cuda(const MatrixStack &rhs) const;
+  product_type multiply_cuda_rns(const MatrixStack &rhs) const;
 
   auto begin() { return data_.begin(); }
   auto end() { return data_.end(); }
@@ -36,122 +46,149 @@ public:
   auto cbegin() const { return data_.cbegin(); }
   auto cend() const { return data_.cend(); }
   constexpr size_t size() const { return N; }
+  T *data() { return data_.data(); }
+  const T *data() const { return data_.data(); }
 
 private:
-  std::array<int32_t, N * N> data_;
+  static constexpr T clamp_to_range(int32_t value) {
+    return static_cast<T>(
+        value < std::numeric_limits<T>::min()
+            ? std::numeric_limits<T>::min()
+            : (value > std::numeric_limits<T>::max()
+                   ? std::numeric_limits<T>::max()
+                   : value));
+  }
+
+  std::array<T, N * N> data_;
 };
 
-template <size_t N>
-inline MatrixStack<N> operator+(MatrixStack<N> lhs, const MatrixStack<N> &rhs) {
+template <size_t N, typename T>
+inline MatrixStack<N, T> operator+(MatrixStack<N, T> lhs,
+                                   const MatrixStack<N, T> &rhs) {
   lhs += rhs;
   return lhs;
 }
 
-template <size_t N>
-inline MatrixStack<N> operator-(MatrixStack<N> lhs, const MatrixStack<N> &rhs) {
+template <size_t N, typename T>
+inline MatrixStack<N, T> operator-(MatrixStack<N, T> lhs,
+                                   const MatrixStack<N, T> &rhs) {
   lhs -= rhs;
   return lhs;
 }
 
-template <size_t N>
-MatrixStack<N> operator*(const MatrixStack<N> &lhs, const MatrixStack<N> &rhs) {
-  MatrixStack<N> result;
+// Full-width storage keeps the reference N³ loop. Narrow storage goes
+// through multiplyRowsCPU, which widens with pmaddwd.
+template <size_t N, typename T>
+typename MatrixStack<N, T>::product_type
+operator*(const MatrixStack<N, T> &lhs, const MatrixStack<N, T> &rhs) {
+  using Acc = accumulator_t<T>;
+  typename MatrixStack<N, T>::product_type result;
+  if (sizeof(T) < sizeof(Acc)) {
+    multiplyRowsCPU(lhs.data(), rhs.data(), result.data(), N, 0, N);
+    return result;
+  }
+
   for (size_t i = 0; i < N; ++i) {
     for (size_t j = 0; j < N; ++j) {
-      int32_t sum{};
+      Acc sum{};
       for (size_t k = 0; k < N; ++k)
-        sum += lhs(i, k) * rhs(k, j);
+        sum += static_cast<Acc>(lhs(i, k)) * rhs(k, j);
       result(i, j) = sum;
     }
   }
   return result;
 }
 
-template <size_t N>
-MatrixStack<N> MatrixStack<N>::multiply_cuda(const MatrixStack<N> &rhs) const {
-  MatrixStack<N> result;
+template <size_t N, typename T>
+typename MatrixStack<N, T>::product_type
+MatrixStack<N, T>::multiply_cuda(const MatrixStack<N, T> &rhs) const {
+  product_type result;
 
-  matrixMultiplyCUDA(data_.data(), rhs.data_.data(), result.data_.data(), N);
+  matrixMultiplyCUDA(data_.data(), rhs.data_.data(), result.data(), N);
 
   return result;
 }
 
-template <size_t N>
-MatrixStack<N>
-MatrixStack<N>::multiply_cuda_rns(const MatrixStack<N> &rhs) const {
-  MatrixStack<N> result;
+template <size_t N, typename T>
+typename MatrixStack<N, T>::product_type
+MatrixStack<N, T>::multiply_cuda_rns(const MatrixStack<N, T> &rhs) const {
+  product_type result;
 
-  rnsMatrixMultiply(data_.data(), rhs.data_.data(), result.data_.data(), N);
+  rnsMatrixMultiply(data_.data(), rhs.data_.data(), result.data(), N);
 
   return result;
 }
 
-template <size_t N>
-MatrixStack<N> operator*(int32_t scalar, MatrixStack<N> mat) {
+template <size_t N, typename T>
+MatrixStack<N, T> operator*(typename non_deduced<T>::type scalar,
+                            MatrixStack<N, T> mat) {
   for (auto &elem : mat)
     elem *= scalar;
   return mat;
 }
 
-template <size_t N>
-MatrixStack<N> operator*(MatrixStack<N> mat, int32_t scalar) {
+template <size_t N, typename T>
+MatrixStack<N, T> operator*(MatrixStack<N, T> mat,
+                            typename non_deduced<T>::type scalar) {
   return scalar * mat;
 }
 
-template <size_t N> MatrixStack<N>::MatrixStack() : data_{} {}
+template <size_t N, typename T> MatrixStack<N, T>::MatrixStack() : data_{} {}
 
-template <size_t N>
-MatrixStack<N>::MatrixStack(std::initializer_list<int32_t> init) {
+template <size_t N, typename T>
+MatrixStack<N, T>::MatrixStack(std::initializer_list<T> init) {
   assert(init.size() == N * N && "Initializer list size mismatch");
   std::copy(init.begin(), init.end(), data_.begin());
 }
 
-template <size_t N>
-int32_t &MatrixStack<N>::operator()(size_t row, size_t col) {
+template <size_t N, typename T>
+T &MatrixStack<N, T>::operator()(size_t row, size_t col) {
   assert(row < N && col < N && "Index out of bounds");
   return data_[row * N + col];
 }
 
-template <size_t N>
-const int32_t &MatrixStack<N>::operator()(size_t row, size_t col) const {
+template <size_t N, typename T>
+const T &MatrixStack<N, T>::operator()(size_t row, size_t col) const {
   assert(row < N && col < N && "Index out of bounds");
   return data_[row * N + col];
 }
 
-template <size_t N>
-MatrixStack<N> &MatrixStack<N>::operator+=(const MatrixStack<N> &rhs) {
+template <size_t N, typename T>
+MatrixStack<N, T> &MatrixStack<N, T>::operator+=(const MatrixStack<N, T> &rhs) {
   for (size_t i = 0; i < N * N; ++i)
     data_[i] += rhs.data_[i];
   return *this;
 }
 
-template <size_t N>
-MatrixStack<N> &MatrixStack<N>::operator-=(const MatrixStack<N> &rhs) {
+template <size_t N, typename T>
+MatrixStack<N, T> &MatrixStack<N, T>::operator-=(const MatrixStack<N, T> &rhs) {
   for (size_t i = 0; i < N * N; ++i)
     data_[i] -= rhs.data_[i];
   return *this;
 }
 
-template <size_t N> MatrixStack<N> MatrixStack<N>::transpose() const {
-  MatrixStack<N> result;
+template <size_t N, typename T>
+MatrixStack<N, T> MatrixStack<N, T>::transpose() const {
+  MatrixStack<N, T> result;
   for (size_t i = 0; i < N; ++i)
     for (size_t j = 0; j < N; ++j)
       result(j, i) = (*this)(i, j);
   return result;
 }
 
-template <size_t N> MatrixStack<N> MatrixStack<N>::create_identity() {
-  MatrixStack<N> result;
+template <size_t N, typename T>
+MatrixStack<N, T> MatrixStack<N, T>::create_identity() {
+  MatrixStack<N, T> result;
   for (size_t i = 0; i < N; ++i)
     result(i, i) = 1;
   return result;
 }
 
-template <size_t N>
-MatrixStack<N> MatrixStack<N>::generate_random(int32_t min, int32_t max) {
+template <size_t N, typename T>
+MatrixStack<N, T> MatrixStack<N, T>::generate_random(T min, T max) {
   assert(min <= max && "Invalid range for random matrix");
 
-  MatrixStack<N> result;
+  MatrixStack<N, T> result;
   std::random_device rd;
   std::mt19937 gen(rd());
 
@@ -161,7 +198,7 @@ MatrixStack<N> MatrixStack<N>::generate_random(int32_t min, int32_t max) {
   for (auto &elem : result.data_) {
     float sample = dist(gen);
     int32_t val = static_cast<int32_t>(std::round(sample));
-    elem = val < min ? min : (val > max ? max : val);
+    elem = static_cast<T>(val < min ? min : (val > max ? max : val));
   }
 
   return result;
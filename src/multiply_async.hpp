@@ -0,0 +1,271 @@
+#ifndef MULTIPLY_ASYNC
+#define MULTIPLY_ASYNC
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "matrix_heap.hpp"
+#include "multiply_cpu.hpp"
+#include "multiply_int32.hpp"
+
+enum class MultiplyBackend { CPU, CUDA, CUDA_RNS };
+
+inline const char *to_string(MultiplyBackend backend) {
+  switch (backend) {
+  case MultiplyBackend::CPU:
+    return "cpu";
+  case MultiplyBackend::CUDA:
+    return "cuda";
+  case MultiplyBackend::CUDA_RNS:
+    return "cuda_rns";
+  }
+  return "unknown";
+}
+
+struct MultiplyServiceOptions {
+  MultiplyBackend backend = MultiplyBackend::CPU;
+  // Most requests executed as one batch.
+  size_t max_batch = 16;
+  // How long the first request of a batch waits for same-shape company.
+  std::chrono::microseconds coalesce_window{50};
+  // Batches in flight at once. With more than one, packing the next batch
+  // overlaps with computing the current one.
+  size_t workers = 2;
+};
+
+// Submission queue for int32 products. Concurrent requests with the same N
+// are coalesced into one batch whose operands are packed contiguously and
+// executed by a single backend call, so small requests share the fixed
+// cost of a CUDA launch and transfer. The CUDA backends fall back to the
+// CPU when no GPU is present.
+class MultiplyService {
+public:
+  using Matrix = MatrixHeap<int32_t>;
+
+  struct Stats {
+    size_t requests;
+    size_t batches;
+  };
+
+  explicit MultiplyService(const MultiplyServiceOptions &options = {})
+      : options_(options), stopping_(false), batches_closed_(false),
+        stats_{0, 0} {
+    assert(options_.max_batch > 0 && options_.workers > 0);
+    if (options_.backend != MultiplyBackend::CPU && !cudaDeviceAvailable())
+      options_.backend = MultiplyBackend::CPU;
+
+    dispatcher_ = std::thread([this] { dispatch(); });
+    for (size_t i = 0; i < options_.workers; ++i)
+      workers_.emplace_back([this] { execute(); });
+  }
+
+  MultiplyService(const MultiplyService &) = delete;
+  MultiplyService &operator=(const MultiplyService &) = delete;
+
+  // Finishes every request already submitted, then stops.
+  ~MultiplyService() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    submitted_.notify_all();
+    dispatcher_.join();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      batches_closed_ = true;
+    }
+    batched_.notify_all();
+    for (auto &worker : workers_)
+      worker.join();
+  }
+
+  std::future<Matrix> submit(Matrix lhs, Matrix rhs) {
+    assert(lhs.size() == rhs.size());
+    Request request{std::move(lhs), std::move(rhs), {}};
+    auto future = request.result.get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      assert(!stopping_ && "Submit after shutdown");
+      pending_.push_back(std::move(request));
+      ++stats_.requests;
+    }
+    submitted_.notify_one();
+    return future;
+  }
+
+  MultiplyBackend backend() const { return options_.backend; }
+
+  Stats stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+private:
+  struct Request {
+    Matrix lhs;
+    Matrix rhs;
+    std::promise<Matrix> result;
+  };
+
+  struct Batch {
+    size_t n;
+    std::vector<int32_t> a;
+    std::vector<int32_t> b;
+    std::vector<std::promise<Matrix>> results;
+  };
+
+  size_t count_pending(size_t n) const {
+    return std::count_if(
+        pending_.begin(), pending_.end(),
+        [n](const Request &request) { return request.lhs.size() == n; });
+  }
+
+  // Stage 1: coalesce same-shape requests and pack their operands.
+  void dispatch() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      submitted_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+      if (pending_.empty())
+        return;
+
+      const size_t n = pending_.front().lhs.size();
+      const auto deadline =
+          std::chrono::steady_clock::now() + options_.coalesce_window;
+      submitted_.wait_until(lock, deadline, [this, n] {
+        return stopping_ || count_pending(n) >= options_.max_batch;
+      });
+
+      std::vector<Request> taken;
+      for (auto it = pending_.begin();
+           it != pending_.end() && taken.size() < options_.max_batch;) {
+        if (it->lhs.size() == n) {
+          taken.push_back(std::move(*it));
+          it = pending_.erase(it);
+        } else {
+          ++it;
+        }
+      }
+      lock.unlock();
+
+      Batch batch{n, {}, {}, {}};
+      batch.a.resize(taken.size() * n * n);
+      batch.b.resize(taken.size() * n * n);
+      for (size_t i = 0; i < taken.size(); ++i) {
+        std::copy(taken[i].lhs.begin(), taken[i].lhs.end(),
+                  batch.a.begin() + i * n * n);
+        std::copy(taken[i].rhs.begin(), taken[i].rhs.end(),
+                  batch.b.begin() + i * n * n);
+        batch.results.push_back(std::move(taken[i].result));
+      }
+
+      lock.lock();
+      batches_.push_back(std::move(batch));
+      ++stats_.batches;
+      batched_.notify_one();
+    }
+  }
+
+  // Stages 2 and 3: run the batch on the backend and complete its futures.
+  void execute() {
+    for (;;) {
+      Batch batch;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        batched_.wait(lock,
+                      [this] { return batches_closed_ || !batches_.empty(); });
+        if (batches_.empty())
+          return;
+        batch = std::move(batches_.front());
+        batches_.pop_front();
+      }
+
+      const size_t n = batch.n;
+      const size_t count = batch.results.size();
+      std::vector<int32_t> c(count * n * n);
+      try {
+        run_batch(batch, c.data());
+      } catch (...) {
+        for (auto &result : batch.results)
+          result.set_exception(std::current_exception());
+        continue;
+      }
+
+      for (size_t i = 0; i < count; ++i) {
+        Matrix result(n);
+        std::copy(c.begin() + i * n * n, c.begin() + (i + 1) * n * n,
+                  result.begin());
+        batch.results[i].set_value(std::move(result));
+      }
+    }
+  }
+
+  void run_batch(const Batch &batch, int32_t *c) const {
+    const size_t n = batch.n;
+    const size_t count = batch.results.size();
+    switch (options_.backend) {
+    case MultiplyBackend::CUDA:
+      matrixMultiplyBatchCUDA(batch.a.data(), batch.b.data(), c, n, count);
+      break;
+    case MultiplyBackend::CUDA_RNS:
+      rnsMatrixMultiplyBatch(batch.a.data(), batch.b.data(), c, n, count);
+      break;
+    case MultiplyBackend::CPU:
+      for (size_t i = 0; i < count; ++i)
+        multiplyRowsCPU(batch.a.data() + i * n * n, batch.b.data() + i * n * n,
+                        c + i * n * n, n, 0, n);
+      break;
+    }
+  }
+
+  MultiplyServiceOptions options_;
+  mutable std::mutex mutex_;
+  std::condition_variable submitted_;
+  std::condition_variable batched_;
+  std::deque<Request> pending_;
+  std::deque<Batch> batches_;
+  bool stopping_;
+  bool batches_closed_;
+  Stats stats_;
+  std::thread dispatcher_;
+  std::vector<std::thread> workers_;
+};
+
+// Process-wide service for `backend`, started on first use.
+inline MultiplyService &shared_multiply_service(MultiplyBackend backend) {
+  MultiplyServiceOptions options;
+  options.backend = backend;
+  switch (backend) {
+  case MultiplyBackend::CPU: {
+    static MultiplyService service(options);
+    return service;
+  }
+  case MultiplyBackend::CUDA_RNS: {
+    static MultiplyService service(options);
+    return service;
+  }
+  case MultiplyBackend::CUDA:
+    break;
+  }
+  static MultiplyService service(options);
+  return service;
+}
+
+// Submits to the shared service for `backend`. The CUDA backends fall back
+// to the CPU when no GPU is present.
+inline std::future<MatrixHeap<int32_t>>
+multiply_async(MatrixHeap<int32_t> lhs, MatrixHeap<int32_t> rhs,
+               MultiplyBackend backend = MultiplyBackend::CUDA) {
+  return shared_multiply_service(backend).submit(std::move(lhs),
+                                                 std::move(rhs));
+}
+
+#endif // !MULTIPLY_ASYNC
@@ -0,0 +1,224 @@
+#ifndef MULTIPLY_AUTO
+#define MULTIPLY_AUTO
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "matrix_heap.hpp"
+#include "multiply_cpu.hpp"
+
+enum class MultiplyVariant { Naive, Tiled, Parallel };
+
+inline const char *to_string(MultiplyVariant variant) {
+  switch (variant) {
+  case MultiplyVariant::Naive:
+    return "naive";
+  case MultiplyVariant::Tiled:
+    return "tiled";
+  case MultiplyVariant::Parallel:
+    return "parallel";
+  }
+  return "unknown";
+}
+
+inline bool parse_variant(const std::string &name, MultiplyVariant &variant) {
+  for (auto candidate : {MultiplyVariant::Naive, MultiplyVariant::Tiled,
+                         MultiplyVariant::Parallel}) {
+    if (name == to_string(candidate)) {
+      variant = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Fastest CPU configuration measured for matrices of size n.
+struct TuningEntry {
+  size_t n;
+  MultiplyVariant variant;
+  size_t tile;
+  size_t threads;
+};
+
+// Winners per size, sorted by n. A query uses the entry with the largest n
+// not above it, or the smallest entry for sizes below the table.
+//
+// File format, one entry per line after '#' comments:
+//   <n> <naive|tiled|parallel> <tile> <threads>
+class TuningTable {
+public:
+  TuningTable() = default;
+  explicit TuningTable(std::vector<TuningEntry> entries)
+      : entries_(std::move(entries)) {
+    std::sort(entries_.begin(), entries_.end(),
+              [](const TuningEntry &a, const TuningEntry &b) {
+                return a.n < b.n;
+              });
+  }
+
+  // Used when no tuning file exists.
+  static TuningTable heuristic() {
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    return TuningTable({{0, MultiplyVariant::Naive, 0, 1},
+                        {64, MultiplyVariant::Tiled, 64, 1},
+                        {256, MultiplyVariant::Parallel, 64, cores}});
+  }
+
+  static bool load(const std::string &path, TuningTable &table) {
+    std::ifstream file(path);
+    if (!file)
+      return false;
+
+    std::vector<TuningEntry> entries;
+    std::string line;
+    while (std::getline(file, line)) {
+      if (line.empty() || line[0] == '#')
+        continue;
+      std::istringstream ss(line);
+      TuningEntry entry{};
+      std::string variant;
+      if (!(ss >> entry.n >> variant >> entry.tile >> entry.threads) ||
+          !parse_variant(variant, entry.variant))
+        return false;
+      if (entry.variant != MultiplyVariant::Naive && entry.tile == 0)
+        return false;
+      entries.push_back(entry);
+    }
+    if (entries.empty())
+      return false;
+
+    table = TuningTable(std::move(entries));
+    return true;
+  }
+
+  bool save(const std::string &path) const {
+    std::ofstream file(path);
+    if (!file)
+      return false;
+    file << "# n variant tile threads\n";
+    for (const auto &entry : entries_)
+      file << entry.n << ' ' << to_string(entry.variant) << ' ' << entry.tile
+           << ' ' << entry.threads << '\n';
+    return static_cast<bool>(file);
+  }
+
+  const TuningEntry &lookup(size_t n) const {
+    assert(!entries_.empty());
+    auto it = std::upper_bound(
+        entries_.begin(), entries_.end(), n,
+        [](size_t value, const TuningEntry &entry) { return value < entry.n; });
+    return it == entries_.begin() ? *it : *(it - 1);
+  }
+
+  const std::vector<TuningEntry> &entries() const { return entries_; }
+
+private:
+  std::vector<TuningEntry> entries_;
+};
+
+template <typename T>
+void multiply_with(const TuningEntry &config, const T *A, const T *B,
+                   accumulator_t<T> *C, size_t N) {
+  switch (config.variant) {
+  case MultiplyVariant::Naive:
+    multiplyRowsCPU(A, B, C, N, 0, N);
+    break;
+  case MultiplyVariant::Tiled:
+    multiplyTiledCPU(A, B, C, N, 0, N, config.tile);
+    break;
+  case MultiplyVariant::Parallel:
+    multiplyParallelCPU(A, B, C, N, config.tile, config.threads);
+    break;
+  }
+}
+
+// Times every CPU variant over `sizes`, tile sizes and thread counts, and
+// keeps the fastest configuration per size (best of `repeats` runs).
+inline TuningTable tune_multiply(const std::vector<size_t> &sizes = {32, 64,
+                                                                     128, 256,
+                                                                     512},
+                                 size_t repeats = 3) {
+  const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<TuningEntry> candidates{{0, MultiplyVariant::Naive, 0, 1}};
+  for (size_t tile : {16, 32, 64, 128}) {
+    candidates.push_back({0, MultiplyVariant::Tiled, tile, 1});
+    for (size_t threads = 2; threads <= cores; threads *= 2)
+      candidates.push_back({0, MultiplyVariant::Parallel, tile, threads});
+    if (cores > 1 && (cores & (cores - 1)) != 0)
+      candidates.push_back({0, MultiplyVariant::Parallel, tile, cores});
+  }
+
+  std::vector<TuningEntry> winners;
+  for (size_t n : sizes) {
+    const auto A = MatrixHeap<int32_t>::generate_random(n, -100, 100);
+    const auto B = MatrixHeap<int32_t>::generate_random(n, -100, 100);
+    MatrixHeap<int32_t> C(n);
+
+    TuningEntry best = candidates.front();
+    auto best_time = std::chrono::steady_clock::duration::max();
+    for (const auto &candidate : candidates) {
+      if (candidate.tile > n)
+        continue;
+      for (size_t r = 0; r < repeats; ++r) {
+        const auto start = std::chrono::steady_clock::now();
+        multiply_with(candidate, A.data(), B.data(), C.data(), n);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed < best_time) {
+          best_time = elapsed;
+          best = candidate;
+        }
+      }
+    }
+    best.n = n;
+    winners.push_back(best);
+  }
+
+  return TuningTable(std::move(winners));
+}
+
+// Path of the tuning file: $RNS_TUNING_FILE or ./rns_tuning.txt.
+inline std::string tuning_file_path() {
+  const char *path = std::getenv("RNS_TUNING_FILE");
+  return path ? path : "rns_tuning.txt";
+}
+
+// Process-wide table, resolved once on first use. Loads the tuning file;
+// if it is missing and RNS_AUTOTUNE is set, tunes and writes it; otherwise
+// uses the heuristic table.
+inline const TuningTable &tuning_table() {
+  static const TuningTable table = [] {
+    TuningTable loaded;
+    const auto path = tuning_file_path();
+    if (TuningTable::load(path, loaded))
+      return loaded;
+    if (std::getenv("RNS_AUTOTUNE")) {
+      loaded = tune_multiply();
+      loaded.save(path);
+      return loaded;
+    }
+    return TuningTable::heuristic();
+  }();
+  return table;
+}
+
+template <typename T>
+MatrixHeap<accumulator_t<T>> multiply_auto(const MatrixHeap<T> &lhs,
+                                           const MatrixHeap<T> &rhs) {
+  assert(lhs.size() == rhs.size());
+  const size_t n = lhs.size();
+
+  MatrixHeap<accumulator_t<T>> result(n);
+  multiply_with(tuning_table().lookup(n), lhs.data(), rhs.data(),
+                result.data(), n);
+  return result;
+}
+
+#endif // !MULTIPLY_AUTO
@@ -0,0 +1,291 @@
+#ifndef MULTIPLY_CPU
+#define MULTIPLY_CPU
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Type products of T are accumulated in. Narrow storage widens to int32_t,
+// so int8/int16 operands give exact int32 results.
+template <typename T> struct accumulator {
+  using type = T;
+};
+template <> struct accumulator<int8_t> {
+  using type = int32_t;
+};
+template <> struct accumulator<int16_t> {
+  using type = int32_t;
+};
+template <typename T> using accumulator_t = typename accumulator<T>::type;
+
+// Keeps T out of deduction, so `2 * m` works for narrow matrices: T comes
+// from the matrix and the int literal converts to it.
+template <typename T> struct non_deduced {
+  using type = T;
+};
+
+// Computes the block [row_begin, row_end) x [col_begin, col_end) of C = A * B
+// for row-major N x N matrices. Uses i-k-j order so the inner loop streams
+// rows of B and C.
+template <typename T, typename Acc>
+void multiplyBlockCPU(const T *A, const T *B, Acc *C, size_t N,
+                      size_t row_begin, size_t row_end, size_t col_begin,
+                      size_t col_end) {
+  assert(row_begin <= row_end && row_end <= N);
+  assert(col_begin <= col_end && col_end <= N);
+  for (size_t i = row_begin; i < row_end; ++i) {
+    Acc *c_row = C + i * N;
+    std::fill(c_row + col_begin, c_row + col_end, Acc{});
+    for (size_t k = 0; k < N; ++k) {
+      const Acc a = A[i * N + k];
+      const T *b_row = B + k * N;
+      for (size_t j = col_begin; j < col_end; ++j)
+        c_row[j] += a * static_cast<Acc>(b_row[j]);
+    }
+  }
+}
+
+// Computes rows [row_begin, row_end) of C = A * B.
+template <typename T, typename Acc>
+void multiplyRowsCPU(const T *A, const T *B, Acc *C, size_t N, size_t row_begin,
+                     size_t row_end) {
+  multiplyBlockCPU(A, B, C, N, row_begin, row_end, 0, N);
+}
+
+#if defined(__SSE2__)
+// int8/int16 rows with pmaddwd, which multiplies pairs of int16 and adds
+// each pair into one int32. B is repacked so that B[k][j] and B[k + 1][j]
+// are adjacent; a broadcast (A[i][k], A[i][k + 1]) pair then yields
+// A[i][k] * B[k][j] + A[i][k + 1] * B[k + 1][j] for 4 (SSE2) or 8 (AVX2)
+// columns per instruction.
+//
+// int8 is widened to int16 while packing, so it runs at the int16 speed:
+// packing B as int8 pairs and sign-extending in registers (pmovsxbw) was
+// measured slower with AVX2, as the kernel is bound by the C row updates
+// rather than by reading B.
+
+// Number of int16 values in B packed by packPairsB.
+inline size_t packedPairsSize(size_t N) { return (N + 1) / 2 * N * 2; }
+
+// Packs row pairs [pair_begin, pair_end) of B, i.e. rows 2 * pair_begin up
+// to 2 * pair_end, into `packed`. An odd last row is paired with zeros.
+template <typename T>
+void packPairsB(const T *B, int16_t *packed, size_t N, size_t pair_begin,
+                size_t pair_end) {
+  assert(pair_begin <= pair_end && pair_end <= (N + 1) / 2);
+  for (size_t p = pair_begin; p < pair_end; ++p) {
+    int16_t *dst = packed + p * N * 2;
+    const T *row0 = B + 2 * p * N;
+    for (size_t j = 0; j < N; ++j) {
+      dst[j * 2] = row0[j];
+      dst[j * 2 + 1] = 2 * p + 1 < N ? row0[N + j] : 0;
+    }
+  }
+}
+
+// Computes rows [row_begin, row_end) of C = A * B from B packed by
+// packPairsB, so several row ranges can share one packing.
+template <typename T>
+void multiplyRowsPackedCPU(const T *A, const int16_t *packed, int32_t *C,
+                           size_t N, size_t row_begin, size_t row_end) {
+  assert(row_begin <= row_end && row_end <= N);
+  const size_t pairs = (N + 1) / 2;
+
+  for (size_t i = row_begin; i < row_end; ++i) {
+    int32_t *c_row = C + i * N;
+    std::fill(c_row, c_row + N, 0);
+    for (size_t p = 0; p < pairs; ++p) {
+      const int16_t a0 = A[i * N + 2 * p];
+      const int16_t a1 = 2 * p + 1 < N ? A[i * N + 2 * p + 1] : 0;
+      const int32_t a_pair = static_cast<int32_t>(
+          static_cast<uint16_t>(a0) |
+          (static_cast<uint32_t>(static_cast<uint16_t>(a1)) << 16));
+      const int16_t *b = packed + p * N * 2;
+
+      size_t j = 0;
+#if defined(__AVX2__)
+      const __m256i a8 = _mm256_set1_epi32(a_pair);
+      for (; j + 8 <= N; j += 8) {
+        __m256i bv = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(b + j * 2));
+        __m256i *cp = reinterpret_cast<__m256i *>(c_row + j);
+        _mm256_storeu_si256(cp, _mm256_add_epi32(_mm256_loadu_si256(cp),
+                                                 _mm256_madd_epi16(a8, bv)));
+      }
+#endif
+      const __m128i a4 = _mm_set1_epi32(a_pair);
+      for (; j + 4 <= N; j += 4) {
+        __m128i bv =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + j * 2));
+        __m128i *cp = reinterpret_cast<__m128i *>(c_row + j);
+        _mm_storeu_si128(
+            cp, _mm_add_epi32(_mm_loadu_si128(cp), _mm_madd_epi16(a4, bv)));
+      }
+      for (; j < N; ++j)
+        c_row[j] += a0 * b[j * 2] + a1 * b[j * 2 + 1];
+    }
+  }
+}
+
+template <typename T>
+void multiplyRowsMaddCPU(const T *A, const T *B, int32_t *C, size_t N,
+                         size_t row_begin, size_t row_end) {
+  std::vector<int16_t> packed(packedPairsSize(N));
+  packPairsB(B, packed.data(), N, 0, (N + 1) / 2);
+  multiplyRowsPackedCPU(A, packed.data(), C, N, row_begin, row_end);
+}
+
+inline void multiplyRowsCPU(const int8_t *A, const int8_t *B, int32_t *C,
+                            size_t N, size_t row_begin, size_t row_end) {
+  multiplyRowsMaddCPU(A, B, C, N, row_begin, row_end);
+}
+
+inline void multiplyRowsCPU(const int16_t *A, const int16_t *B, int32_t *C,
+                            size_t N, size_t row_begin, size_t row_end) {
+  multiplyRowsMaddCPU(A, B, C, N, row_begin, row_end);
+}
+#endif
+
+// B in the layout the row kernel for T reads, so callers that run many row
+// ranges prepare it once. Full-width types read B as is.
+template <typename T> struct RowsOperand {
+  using type = T;
+
+  static size_t size(size_t N) { return N * N; }
+
+  // Prepares share `part` of `parts` of the layout, so that several
+  // threads can each first-touch their own share.
+  static void prepare(const T *B, type *b, size_t N, size_t part = 0,
+                      size_t parts = 1) {
+    const size_t first = N * part / parts * N;
+    const size_t last = N * (part + 1) / parts * N;
+    std::copy(B + first, B + last, b + first);
+  }
+
+  static void multiply(const T *A, const type *b, accumulator_t<T> *C,
+                       size_t N, size_t row_begin, size_t row_end) {
+    multiplyRowsCPU(A, b, C, N, row_begin, row_end);
+  }
+};
+
+#if defined(__SSE2__)
+// Narrow types read B packed by packPairsB.
+template <typename T> struct MaddRowsOperand {
+  using type = int16_t;
+
+  static size_t size(size_t N) { return packedPairsSize(N); }
+
+  static void prepare(const T *B, type *b, size_t N, size_t part = 0,
+                      size_t parts = 1) {
+    const size_t pairs = (N + 1) / 2;
+    packPairsB(B, b, N, pairs * part / parts, pairs * (part + 1) / parts);
+  }
+
+  static void multiply(const T *A, const type *b, int32_t *C, size_t N,
+                       size_t row_begin, size_t row_end) {
+    multiplyRowsPackedCPU(A, b, C, N, row_begin, row_end);
+  }
+};
+
+template <> struct RowsOperand<int8_t> : MaddRowsOperand<int8_t> {};
+template <> struct RowsOperand<int16_t> : MaddRowsOperand<int16_t> {};
+#endif
+
+// Computes rows [row_begin, row_end) of C = A * B, blocking k and j by
+// `tile` so the touched part of B stays in cache across rows.
+template <typename T, typename Acc>
+void multiplyTiledCPU(const T *A, const T *B, Acc *C, size_t N,
+                      size_t row_begin, size_t row_end, size_t tile) {
+  assert(row_begin <= row_end && row_end <= N);
+  assert(tile > 0 && "Tile size must be positive");
+  std::fill(C + row_begin * N, C + row_end * N, Acc{});
+  for (size_t kk = 0; kk < N; kk += tile) {
+    const size_t k_end = std::min(kk + tile, N);
+    for (size_t jj = 0; jj < N; jj += tile) {
+      const size_t j_end = std::min(jj + tile, N);
+      for (size_t i = row_begin; i < row_end; ++i) {
+        Acc *c_row = C + i * N;
+        for (size_t k = kk; k < k_end; ++k) {
+          const Acc a = A[i * N + k];
+          const T *b_row = B + k * N;
+          for (size_t j = jj; j < j_end; ++j)
+            c_row[j] += a * static_cast<Acc>(b_row[j]);
+        }
+      }
+    }
+  }
+}
+
+// Splits the rows of C into `threads` contiguous ranges, each computed by
+// multiplyTiledCPU on its own thread.
+template <typename T, typename Acc>
+void multiplyParallelCPU(const T *A, const T *B, Acc *C, size_t N, size_t tile,
+                         size_t threads) {
+  threads = std::max<size_t>(1, std::min(threads, N));
+  if (threads == 1) {
+    multiplyTiledCPU(A, B, C, N, 0, N, tile);
+    return;
+  }
+
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; ++t)
+    workers.emplace_back(multiplyTiledCPU<T, Acc>, A, B, C, N, N * t / threads,
+                         N * (t + 1) / threads, tile);
+  for (auto &worker : workers)
+    worker.join();
+}
+
+// Splits the rows of C into `threads` contiguous ranges computed by the row
+// kernel, all reading one shared RowsOperand copy of B.
+template <typename T>
+void multiplyParallelRowsCPU(const T *A, const T *B, accumulator_t<T> *C,
+                             size_t N, size_t threads) {
+  using Operand = RowsOperand<T>;
+  threads = std::max<size_t>(1, std::min(threads, N));
+  std::vector<typename Operand::type> b(Operand::size(N));
+  Operand::prepare(B, b.data(), N);
+
+  std::vector<std::thread> workers;
+  for (size_t t = 1; t < threads; ++t)
+    workers.emplace_back(Operand::multiply, A, b.data(), C, N,
+                         N * t / threads, N * (t + 1) / threads);
+  Operand::multiply(A, b.data(), C, N, 0, N / threads);
+  for (auto &worker : workers)
+    worker.join();
+}
+
+#if defined(__SSE2__)
+// Narrow types always run the pmaddwd row kernel, whose packed B already
+// streams rows; `tile` does not apply to it.
+inline void multiplyTiledCPU(const int8_t *A, const int8_t *B, int32_t *C,
+                             size_t N, size_t row_begin, size_t row_end,
+                             size_t /*tile*/) {
+  multiplyRowsCPU(A, B, C, N, row_begin, row_end);
+}
+
+inline void multiplyTiledCPU(const int16_t *A, const int16_t *B, int32_t *C,
+                             size_t N, size_t row_begin, size_t row_end,
+                             size_t /*tile*/) {
+  multiplyRowsCPU(A, B, C, N, row_begin, row_end);
+}
+
+inline void multiplyParallelCPU(const int8_t *A, const int8_t *B, int32_t *C,
+                                size_t N, size_t /*tile*/, size_t threads) {
+  multiplyParallelRowsCPU(A, B, C, N, threads);
+}
+
+inline void multiplyParallelCPU(const int16_t *A, const int16_t *B,
+                                int32_t *C, size_t N, size_t /*tile*/,
+                                size_t threads) {
+  multiplyParallelRowsCPU(A, B, C, N, threads);
+}
+#endif
+
+#endif // !MULTIPLY_CPU
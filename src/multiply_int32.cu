@@ -3,45 +3,158 @@
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <cuda_runtime.h>
+#include <mutex>
 
-__global__ void matrixMultiplyKernel(const int32_t *A, const int32_t *B,
-                                     int32_t *C, size_t N) {
+template <typename T>
+__global__ void matrixMultiplyKernel(const T *A, const T *B, int32_t *C,
+                                     size_t N) {
   int32_t row = blockIdx.y * blockDim.y + threadIdx.y;
   int32_t col = blockIdx.x * blockDim.x + threadIdx.x;
 
   if (row < N && col < N) {
     int32_t sum = 0;
     for (int32_t k = 0; k < N; ++k) {
-      sum += A[row * N + k] * B[k * N + col];
+      sum += static_cast<int32_t>(A[row * N + k]) * B[k * N + col];
     }
     C[row * N + col] = sum;
   }
 }
 
-void matrixMultiplyCUDA(const int32_t *A, const int32_t *B, int32_t *C,
-                        size_t N) {
-  int32_t *d_A, *d_B, *d_C;
-  size_t size = N * N * sizeof(int32_t);
+// Items of a batch are spread round-robin over this many streams. Each
+// stream owns one slot of device buffers; items on the same stream run in
+// order, so reusing the slot is safe.
+const size_t num_streams = 4;
+
+// Device allocation reused across calls, grown on demand.
+struct DeviceBuffer {
+  void *ptr = nullptr;
+  size_t bytes = 0;
+
+  template <typename U> U *get(size_t count) {
+    if (count * sizeof(U) > bytes) {
+      cudaFree(ptr);
+      bytes = count * sizeof(U);
+      cudaMalloc(&ptr, bytes);
+    }
+    return static_cast<U *>(ptr);
+  }
+};
+
+// Page-locked host staging, grown on demand. Copies from pageable memory
+// are staged synchronously by the driver, so only copies from pinned
+// memory overlap with kernels running on other streams.
+struct PinnedBuffer {
+  void *ptr = nullptr;
+  size_t bytes = 0;
+
+  template <typename U> U *get(size_t count) {
+    if (count * sizeof(U) > bytes) {
+      cudaFreeHost(ptr);
+      bytes = count * sizeof(U);
+      cudaMallocHost(&ptr, bytes);
+    }
+    return static_cast<U *>(ptr);
+  }
+};
+
+// Streams, buffers and RNS constants shared by every call, so a call pays
+// no allocation, stream creation or constant upload once warmed up. Calls
+// are serialized on `mutex` because they share the buffers.
+struct CudaWorkspace {
+  std::mutex mutex;
+  cudaStream_t streams[num_streams];
+  DeviceBuffer d_A, d_B, d_C, d_A_res, d_B_res, d_C_res;
+  PinnedBuffer h_A, h_B, h_C;
+  int *d_moduli = nullptr;
+  int *d_term_i = nullptr;
+
+  CudaWorkspace() {
+    for (auto &stream : streams)
+      cudaStreamCreate(&stream);
+  }
+};
+
+// Never destroyed: the CUDA runtime may already be torn down when static
+// destructors run, and the driver releases everything at process exit.
+static CudaWorkspace &workspace() {
+  static CudaWorkspace *instance = new CudaWorkspace;
+  return *instance;
+}
+
+bool cudaDeviceAvailable() {
+  int count = 0;
+  return cudaGetDeviceCount(&count) == cudaSuccess && count > 0;
+}
+
+// T is the operand storage type; C is always int32.
+template <typename T>
+static void matrixMultiplyBatch(const T *A, const T *B, int32_t *C, size_t N,
+                                size_t batch) {
+  if (batch == 0)
+    return;
+
+  const size_t elems = N * N;
+  const size_t in_size = elems * sizeof(T);
+  const size_t size = elems * sizeof(int32_t);
+  const size_t stream_count = batch < num_streams ? batch : num_streams;
 
-  cudaMalloc(&d_A, size);
-  cudaMalloc(&d_B, size);
-  cudaMalloc(&d_C, size);
+  CudaWorkspace &ws = workspace();
+  std::lock_guard<std::mutex> lock(ws.mutex);
 
-  cudaMemcpy(d_A, A, size, cudaMemcpyHostToDevice);
-  cudaMemcpy(d_B, B, size, cudaMemcpyHostToDevice);
+  T *h_A = ws.h_A.get<T>(batch * elems), *h_B = ws.h_B.get<T>(batch * elems);
+  int32_t *h_C = ws.h_C.get<int32_t>(batch * elems);
+  T *d_A = ws.d_A.get<T>(stream_count * elems),
+    *d_B = ws.d_B.get<T>(stream_count * elems);
+  int32_t *d_C = ws.d_C.get<int32_t>(stream_count * elems);
 
   dim3 blockSize(16, 16);
   dim3 gridSize((N + blockSize.x - 1) / blockSize.x,
                 (N + blockSize.y - 1) / blockSize.y);
 
-  matrixMultiplyKernel<<<gridSize, blockSize>>>(d_A, d_B, d_C, N);
+  // Staging item i into pinned memory overlaps with the GPU work already
+  // queued for earlier items.
+  for (size_t i = 0; i < batch; ++i) {
+    const size_t s = i % stream_count;
+    T *a = d_A + s * elems, *b = d_B + s * elems;
+    int32_t *c = d_C + s * elems;
+
+    std::memcpy(h_A + i * elems, A + i * elems, in_size);
+    std::memcpy(h_B + i * elems, B + i * elems, in_size);
+    cudaMemcpyAsync(a, h_A + i * elems, in_size, cudaMemcpyHostToDevice,
+                    ws.streams[s]);
+    cudaMemcpyAsync(b, h_B + i * elems, in_size, cudaMemcpyHostToDevice,
+                    ws.streams[s]);
+    matrixMultiplyKernel<<<gridSize, blockSize, 0, ws.streams[s]>>>(a, b, c,
+                                                                     N);
+    cudaMemcpyAsync(h_C + i * elems, c, size, cudaMemcpyDeviceToHost,
+                    ws.streams[s]);
+  }
+
+  for (size_t s = 0; s < stream_count; ++s)
+    cudaStreamSynchronize(ws.streams[s]);
+  std::memcpy(C, h_C, batch * size);
+}
+
+void matrixMultiplyCUDA(const int32_t *A, const int32_t *B, int32_t *C,
+                        size_t N) {
+  matrixMultiplyBatch(A, B, C, N, 1);
+}
+
+void matrixMultiplyCUDA(const int8_t *A, const int8_t *B, int32_t *C,
+                        size_t N) {
+  matrixMultiplyBatch(A, B, C, N, 1);
+}
 
-  cudaMemcpy(C, d_C, size, cudaMemcpyDeviceToHost);
+void matrixMultiplyCUDA(const int16_t *A, const int16_t *B, int32_t *C,
+                        size_t N) {
+  matrixMultiplyBatch(A, B, C, N, 1);
+}
 
-  cudaFree(d_A);
-  cudaFree(d_B);
-  cudaFree(d_C);
+void matrixMultiplyBatchCUDA(const int32_t *A, const int32_t *B, int32_t *C,
+                             size_t N, size_t batch) {
+  matrixMultiplyBatch(A, B, C, N, batch);
 }
 
 // RNS
@@ -53,7 +166,10 @@ const int M = 2 * 3 * 5 * 7 * 11 * 13 * 17 * 19;
 const int term_i[] = {4849845, 3233230, 3879876, 8314020,
                       6172530, 3730650, 9129120, 9189180};
 
-__global__ void convertToRNSKernel(const int32_t *A, int8_t *A_res,
+// Reads operands in their storage type, so int8/int16 inputs are reduced
+// to residues directly without an int32 copy.
+template <typename T>
+__global__ void convertToRNSKernel(const T *A, int8_t *A_res,
                                    const int *d_moduli, size_t N) {
   size_t x = blockIdx.x * blockDim.x + threadIdx.x;
   size_t y = blockIdx.y * blockDim.y + threadIdx.y;
@@ -115,55 +231,95 @@ __global__ void combineCRTKernel(const int8_t *C_res, int32_t *C,
   C[idx] = sum;
 }
 
-void rnsMatrixMultiply(const int32_t *h_A, const int32_t *h_B, int32_t *h_C,
-                       size_t N) {
-  int32_t *d_A, *d_B;
-  int8_t *d_A_res, *d_B_res, *d_C_res;
-  int32_t *d_C;
-  int *d_moduli, *d_term_i;
-
-  cudaMalloc(&d_A, N * N * sizeof(int32_t));
-  cudaMalloc(&d_B, N * N * sizeof(int32_t));
-  cudaMemcpy(d_A, h_A, N * N * sizeof(int32_t), cudaMemcpyHostToDevice);
-  cudaMemcpy(d_B, h_B, N * N * sizeof(int32_t), cudaMemcpyHostToDevice);
-
-  size_t rns_size = num_moduli * N * N * sizeof(int8_t);
-  cudaMalloc(&d_A_res, rns_size);
-  cudaMalloc(&d_B_res, rns_size);
-
-  cudaMalloc(&d_moduli, num_moduli * sizeof(int));
-  cudaMemcpy(d_moduli, moduli, num_moduli * sizeof(int),
-             cudaMemcpyHostToDevice);
-  cudaMalloc(&d_term_i, num_moduli * sizeof(int));
-  cudaMemcpy(d_term_i, term_i, num_moduli * sizeof(int),
-             cudaMemcpyHostToDevice);
+template <typename T>
+static void rnsMultiplyBatch(const T *A, const T *B, int32_t *C, size_t N,
+                             size_t batch) {
+  if (batch == 0)
+    return;
+
+  const size_t elems = N * N;
+  const size_t in_size = elems * sizeof(T);
+  const size_t size = elems * sizeof(int32_t);
+  const size_t rns_elems = num_moduli * elems;
+  const size_t stream_count = batch < num_streams ? batch : num_streams;
+
+  CudaWorkspace &ws = workspace();
+  std::lock_guard<std::mutex> lock(ws.mutex);
+
+  if (!ws.d_moduli) {
+    cudaMalloc(&ws.d_moduli, num_moduli * sizeof(int));
+    cudaMemcpy(ws.d_moduli, moduli, num_moduli * sizeof(int),
+               cudaMemcpyHostToDevice);
+    cudaMalloc(&ws.d_term_i, num_moduli * sizeof(int));
+    cudaMemcpy(ws.d_term_i, term_i, num_moduli * sizeof(int),
+               cudaMemcpyHostToDevice);
+  }
+
+  T *h_A = ws.h_A.get<T>(batch * elems), *h_B = ws.h_B.get<T>(batch * elems);
+  int32_t *h_C = ws.h_C.get<int32_t>(batch * elems);
+  T *d_A = ws.d_A.get<T>(stream_count * elems),
+    *d_B = ws.d_B.get<T>(stream_count * elems);
+  int32_t *d_C = ws.d_C.get<int32_t>(stream_count * elems);
+  int8_t *d_A_res = ws.d_A_res.get<int8_t>(stream_count * rns_elems),
+         *d_B_res = ws.d_B_res.get<int8_t>(stream_count * rns_elems),
+         *d_C_res = ws.d_C_res.get<int8_t>(stream_count * rns_elems);
 
   dim3 block(16, 16);
   dim3 grid((N + 15) / 16, (N + 15) / 16);
-  convertToRNSKernel<<<grid, block>>>(d_A, d_A_res, d_moduli, N);
-  convertToRNSKernel<<<grid, block>>>(d_B, d_B_res, d_moduli, N);
-  cudaDeviceSynchronize();
 
-  cudaMalloc(&d_C_res, rns_size);
+  // Kernels on one stream run in order, so conversion, per-modulus
+  // products and CRT need no device-wide synchronization between them.
+  for (size_t item = 0; item < batch; ++item) {
+    const size_t s = item % stream_count;
+    cudaStream_t stream = ws.streams[s];
+    T *a = d_A + s * elems, *b = d_B + s * elems;
+    int32_t *c = d_C + s * elems;
+    int8_t *a_res = d_A_res + s * rns_elems, *b_res = d_B_res + s * rns_elems,
+           *c_res = d_C_res + s * rns_elems;
+
+    std::memcpy(h_A + item * elems, A + item * elems, in_size);
+    std::memcpy(h_B + item * elems, B + item * elems, in_size);
+    cudaMemcpyAsync(a, h_A + item * elems, in_size, cudaMemcpyHostToDevice,
+                    stream);
+    cudaMemcpyAsync(b, h_B + item * elems, in_size, cudaMemcpyHostToDevice,
+                    stream);
+
+    convertToRNSKernel<<<grid, block, 0, stream>>>(a, a_res, ws.d_moduli, N);
+    convertToRNSKernel<<<grid, block, 0, stream>>>(b, b_res, ws.d_moduli, N);
+
+    for (int i = 0; i < num_moduli; ++i) {
+      matrixMulModKernel<<<grid, block, 0, stream>>>(
+          a_res + i * elems, b_res + i * elems, c_res + i * elems, moduli[i],
+          N);
+    }
+
+    combineCRTKernel<<<grid, block, 0, stream>>>(c_res, c, ws.d_term_i, N);
 
-  for (int i = 0; i < num_moduli; ++i) {
-    matrixMulModKernel<<<grid, block>>>(d_A_res + i * N * N,
-                                        d_B_res + i * N * N,
-                                        d_C_res + i * N * N, moduli[i], N);
+    cudaMemcpyAsync(h_C + item * elems, c, size, cudaMemcpyDeviceToHost,
+                    stream);
   }
-  cudaDeviceSynchronize();
-
-  cudaMalloc(&d_C, N * N * sizeof(int32_t));
-  combineCRTKernel<<<grid, block>>>(d_C_res, d_C, d_term_i, N);
-  cudaDeviceSynchronize();
-
-  cudaMemcpy(h_C, d_C, N * N * sizeof(int32_t), cudaMemcpyDeviceToHost);
-  cudaFree(d_A);
-  cudaFree(d_B);
-  cudaFree(d_A_res);
-  cudaFree(d_B_res);
-  cudaFree(d_C_res);
-  cudaFree(d_C);
-  cudaFree(d_moduli);
-  cudaFree(d_term_i);
+
+  for (size_t s = 0; s < stream_count; ++s)
+    cudaStreamSynchronize(ws.streams[s]);
+  std::memcpy(C, h_C, batch * size);
+}
+
+void rnsMatrixMultiply(const int32_t *h_A, const int32_t *h_B, int32_t *h_C,
+                       size_t N) {
+  rnsMultiplyBatch(h_A, h_B, h_C, N, 1);
+}
+
+void rnsMatrixMultiply(const int8_t *h_A, const int8_t *h_B, int32_t *h_C,
+                       size_t N) {
+  rnsMultiplyBatch(h_A, h_B, h_C, N, 1);
+}
+
+void rnsMatrixMultiply(const int16_t *h_A, const int16_t *h_B, int32_t *h_C,
+                       size_t N) {
+  rnsMultiplyBatch(h_A, h_B, h_C, N, 1);
+}
+
+void rnsMatrixMultiplyBatch(const int32_t *h_A, const int32_t *h_B,
+                            int32_t *h_C, size_t N, size_t batch) {
+  rnsMultiplyBatch(h_A, h_B, h_C, N, batch);
 }
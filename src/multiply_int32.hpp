@@ -10,4 +10,29 @@ void matrixMultiplyCUDA(const int32_t *A, const int32_t *B, int32_t *C,
 void rnsMatrixMultiply(const int32_t *h_A, const int32_t *h_B, int32_t *h_C,
                        size_t N);
 
+// Narrow operands are copied to the device as-is and widened (or reduced to
+// residues) there, so transfers shrink with the storage type. Results are
+// int32.
+void matrixMultiplyCUDA(const int8_t *A, const int8_t *B, int32_t *C,
+                        size_t N);
+void matrixMultiplyCUDA(const int16_t *A, const int16_t *B, int32_t *C,
+                        size_t N);
+
+void rnsMatrixMultiply(const int8_t *h_A, const int8_t *h_B, int32_t *h_C,
+                       size_t N);
+void rnsMatrixMultiply(const int16_t *h_A, const int16_t *h_B, int32_t *h_C,
+                       size_t N);
+
+// Batched variants: A, B and C hold `batch` consecutive N x N matrices.
+// Items are staged through pinned host memory and spread over several CUDA
+// streams, so transfers of one item overlap with kernels of another.
+// Streams and buffers persist across calls; concurrent calls serialize.
+void matrixMultiplyBatchCUDA(const int32_t *A, const int32_t *B, int32_t *C,
+                             size_t N, size_t batch);
+
+void rnsMatrixMultiplyBatch(const int32_t *h_A, const int32_t *h_B,
+                            int32_t *h_C, size_t N, size_t batch);
+
+bool cudaDeviceAvailable();
+
 #endif // !MULTIPLY_INT32
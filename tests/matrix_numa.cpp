@@ -0,0 +1,118 @@
+#include "../src/matrix_numa.hpp"
+#include <gtest/gtest.h>
+
+static void AssertMatrixEqual(const MatrixHeap<int32_t> &a,
+                              const MatrixHeap<int32_t> &b) {
+  ASSERT_EQ(a.size(), b.size());
+  for (size_t i = 0; i < a.size(); ++i) {
+    for (size_t j = 0; j < a.size(); ++j) {
+      ASSERT_EQ(a(i, j), b(i, j)) << "Mismatch at (" << i << "," << j << ")";
+    }
+  }
+}
+
+TEST(MatrixNUMA, ParseCpuList) {
+  EXPECT_EQ(parse_cpu_list("0-3,8,10-11\n"),
+            (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_EQ(parse_cpu_list("5"), (std::vector<int>{5}));
+  EXPECT_TRUE(parse_cpu_list("").empty());
+}
+
+TEST(MatrixNUMA, TopologyHasCpus) {
+  auto nodes = numa_topology();
+  ASSERT_FALSE(nodes.empty());
+  for (const auto &node : nodes)
+    EXPECT_FALSE(node.cpus.empty());
+}
+
+TEST(MatrixNUMA, TopologyRespectsAffinity) {
+  auto allowed = allowed_cpus();
+  if (allowed.empty())
+    GTEST_SKIP() << "sched_getaffinity unavailable";
+  for (const auto &node : numa_topology())
+    for (int cpu : node.cpus)
+      EXPECT_TRUE(std::binary_search(allowed.begin(), allowed.end(), cpu))
+          << "CPU " << cpu << " is outside the affinity mask";
+}
+
+TEST(MatrixNUMA, AllPlacementsMatchNaive) {
+  auto A = MatrixHeap<int32_t>::generate_random(45, -100, 100);
+  auto B = MatrixHeap<int32_t>::generate_random(45, -100, 100);
+  auto expected = A * B;
+
+  for (auto placement : {NumaPlacement::Default, NumaPlacement::Local,
+                         NumaPlacement::Interleaved}) {
+    NumaOptions options;
+    options.placement = placement;
+    options.threads = 3;
+    options.tile_rows = 4;
+    AssertMatrixEqual(expected, multiply_numa(A, B, options));
+  }
+}
+
+TEST(MatrixNUMA, SingleThread) {
+  MatrixHeap<int32_t> A{1, 2, 3, 4};
+  MatrixHeap<int32_t> B{5, 6, 7, 8};
+  NumaOptions options;
+  options.threads = 1;
+  AssertMatrixEqual(MatrixHeap<int32_t>{19, 22, 43, 50},
+                    multiply_numa(A, B, options));
+}
+
+TEST(MatrixNUMA, Int8AccumulatesInInt32) {
+  MatrixHeap<int8_t> A(8), B(8);
+  std::fill(A.begin(), A.end(), 100);
+  std::fill(B.begin(), B.end(), 100);
+  MatrixHeap<int32_t> expected(8);
+  std::fill(expected.begin(), expected.end(), 80000);
+
+  NumaOptions options;
+  options.threads = 3;
+  options.tile_rows = 2;
+  AssertMatrixEqual(expected, multiply_numa(A, B, options));
+}
+
+TEST(MatrixNUMA, TopologyIsCached) {
+  EXPECT_EQ(&numa_topology(), &numa_topology());
+}
+
+TEST(MatrixNUMA, MultiplierReusesPlacedBuffers) {
+  for (auto placement : {NumaPlacement::Default, NumaPlacement::Local,
+                         NumaPlacement::Interleaved}) {
+    NumaOptions options;
+    options.placement = placement;
+    options.threads = 3;
+    options.tile_rows = 4;
+    NumaMultiplier<int32_t> numa(21, options);
+    const int32_t *result = numa.result();
+
+    for (int round = 0; round < 2; ++round) {
+      auto A = MatrixHeap<int32_t>::generate_random(21, -100, 100);
+      auto B = MatrixHeap<int32_t>::generate_random(21, -100, 100);
+      std::copy(A.begin(), A.end(), numa.lhs());
+      std::copy(B.begin(), B.end(), numa.rhs());
+      numa.multiply();
+
+      MatrixHeap<int32_t> product(21);
+      std::copy(numa.result(), numa.result() + 21 * 21, product.begin());
+      AssertMatrixEqual(A * B, product);
+      EXPECT_EQ(result, numa.result());
+    }
+  }
+}
+
+TEST(MatrixNUMA, MultiplierHandlesNarrowStorage) {
+  NumaOptions options;
+  options.threads = 2;
+  options.tile_rows = 3;
+  NumaMultiplier<int16_t> numa(13, options);
+  auto A = MatrixHeap<int16_t>::generate_random(13, -1000, 1000);
+  auto B = MatrixHeap<int16_t>::generate_random(13, -1000, 1000);
+  std::copy(A.begin(), A.end(), numa.lhs());
+  std::copy(B.begin(), B.end(), numa.rhs());
+  numa.multiply();
+
+  MatrixHeap<int32_t> product(13);
+  std::copy(numa.result(), numa.result() + 13 * 13, product.begin());
+  AssertMatrixEqual(A * B, product);
+}
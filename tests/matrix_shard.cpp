@@ -0,0 +1,123 @@
+#include "../src/matrix_shard.hpp"
+#include <cstdlib>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static void AssertMatrixEqual(const MatrixHeap<int32_t> &a,
+                              const MatrixHeap<int32_t> &b) {
+  ASSERT_EQ(a.size(), b.size());
+  for (size_t i = 0; i < a.size(); ++i) {
+    for (size_t j = 0; j < a.size(); ++j) {
+      ASSERT_EQ(a(i, j), b(i, j)) << "Mismatch at (" << i << "," << j << ")";
+    }
+  }
+}
+
+TEST(MatrixShard, PlanCoversMatrix) {
+  auto shards = plan_shards(10, 4, 3);
+  std::vector<int> hits(100, 0);
+  for (const auto &shard : shards)
+    for (size_t i = shard.row_begin; i < shard.row_end; ++i)
+      for (size_t j = shard.col_begin; j < shard.col_end; ++j)
+        ++hits[i * 10 + j];
+
+  EXPECT_EQ(shards.size(), 12u);
+  for (int hit : hits)
+    EXPECT_EQ(hit, 1);
+}
+
+TEST(MatrixShard, RegionIsSharedByName) {
+  const std::string name = "/rns-shard-test-" + std::to_string(getpid());
+  auto owner = SharedMatrixRegion::create(name, 3);
+  owner.a()[4] = 42;
+
+  auto view = SharedMatrixRegion::open(name);
+  EXPECT_EQ(view.size(), 3u);
+  EXPECT_EQ(view.a()[4], 42);
+}
+
+TEST(MatrixShard, OpenRejectsTruncatedRegion) {
+  const std::string name = "/rns-shard-short-" + std::to_string(getpid());
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(ftruncate(fd, 16), 0);
+  EXPECT_THROW(SharedMatrixRegion::open(name), std::runtime_error);
+
+  // A header claiming N = 100 over room for a much smaller matrix.
+  ASSERT_EQ(ftruncate(fd, SharedMatrixRegion::header_bytes + 64), 0);
+  const uint64_t n = 100;
+  ASSERT_EQ(pwrite(fd, &n, sizeof(n), 0), static_cast<ssize_t>(sizeof(n)));
+  EXPECT_THROW(SharedMatrixRegion::open(name), std::runtime_error);
+
+  close(fd);
+  shm_unlink(name.c_str());
+}
+
+TEST(MatrixShard, OtherChildrenAreNotReaped) {
+  pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0)
+    _exit(7);
+
+  auto A = MatrixHeap<int32_t>::generate_random(16, -100, 100);
+  auto B = MatrixHeap<int32_t>::generate_random(16, -100, 100);
+  ShardedMultiplyOptions options;
+  options.block_rows = 4;
+  AssertMatrixEqual(A * B, multiply_sharded(A, B, options));
+
+  int status = 0;
+  ASSERT_EQ(waitpid(child, &status, 0), child);
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 7);
+}
+
+TEST(MatrixShard, RowShards) {
+  auto A = MatrixHeap<int32_t>::generate_random(37, -100, 100);
+  auto B = MatrixHeap<int32_t>::generate_random(37, -100, 100);
+  ShardedMultiplyOptions options;
+  options.workers = 3;
+  options.block_rows = 8;
+  AssertMatrixEqual(A * B, multiply_sharded(A, B, options));
+}
+
+TEST(MatrixShard, BlockShards) {
+  auto A = MatrixHeap<int32_t>::generate_random(33, -100, 100);
+  auto B = MatrixHeap<int32_t>::generate_random(33, -100, 100);
+  ShardedMultiplyOptions options;
+  options.workers = 4;
+  options.block_rows = 10;
+  options.block_cols = 7;
+  AssertMatrixEqual(A * B, multiply_sharded(A, B, options));
+}
+
+TEST(MatrixShard, FailedShardIsRetried) {
+  auto A = MatrixHeap<int32_t>::generate_random(16, -100, 100);
+  auto B = MatrixHeap<int32_t>::generate_random(16, -100, 100);
+  ShardedMultiplyOptions options;
+  options.workers = 2;
+  options.block_rows = 4;
+
+  auto flaky = [](const int32_t *A, const int32_t *B, int32_t *C, size_t N,
+                  const MatrixShard &shard) {
+    if (shard.attempt == 0 && shard.row_begin == 4)
+      _exit(1);
+    multiply_shard_cpu(A, B, C, N, shard);
+  };
+  AssertMatrixEqual(A * B, multiply_sharded(A, B, options, flaky));
+}
+
+TEST(MatrixShard, ShardFailingEveryAttemptThrows) {
+  auto A = MatrixHeap<int32_t>::generate_random(8, -100, 100);
+  auto B = MatrixHeap<int32_t>::generate_random(8, -100, 100);
+  ShardedMultiplyOptions options;
+  options.workers = 2;
+  options.block_rows = 4;
+  options.max_attempts = 2;
+
+  auto broken = [](const int32_t *, const int32_t *, int32_t *, size_t,
+                   const MatrixShard &) { std::abort(); };
+  EXPECT_THROW(multiply_sharded(A, B, options, broken), std::runtime_error);
+}
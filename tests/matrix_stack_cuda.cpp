@@ -1,3 +1,4 @@
+#include "../src/matrix_heap.hpp"
 #include "../src/matrix_stack.hpp"
 #include <gtest/gtest.h>
 
@@ -43,3 +44,27 @@ TEST(MatrixStackCUDA, SingleElement) {
   auto B = MatrixStack<N>::generate_random(-100, 100);
   AssertMatrixEqual(A * B, A.multiply_cuda(B));
 }
+
+TEST(MatrixStackCUDA, Int8Operands) {
+  constexpr size_t N = 16;
+  auto A = MatrixStack<N, int8_t>::generate_random(-100, 100);
+  auto B = MatrixStack<N, int8_t>::generate_random(-100, 100);
+  AssertMatrixEqual(A * B, A.multiply_cuda(B));
+}
+
+TEST(MatrixStackCUDA, Int16Operands) {
+  constexpr size_t N = 15;
+  auto A = MatrixStack<N, int16_t>::generate_random(-1000, 1000);
+  auto B = MatrixStack<N, int16_t>::generate_random(-1000, 1000);
+  AssertMatrixEqual(A * B, A.multiply_cuda(B));
+}
+
+TEST(MatrixHeapCUDA, Int8OperandsGiveInt32) {
+  auto A = MatrixHeap<int8_t>::generate_random(16, -100, 100);
+  auto B = MatrixHeap<int8_t>::generate_random(16, -100, 100);
+  MatrixHeap<int32_t> result = A.multiply_cuda(B);
+  auto expected = A * B;
+  for (size_t i = 0; i < 16; ++i)
+    for (size_t j = 0; j < 16; ++j)
+      ASSERT_EQ(result(i, j), expected(i, j));
+}
@@ -50,3 +50,17 @@ TEST(MatrixStackCUDA_RNS, SingleElement) {
   auto B = MatrixStack<N>::generate_random(-100, 100);
   AssertMatrixEqual(A * B, A.multiply_cuda_rns(B));
 }
+
+TEST(MatrixStackCUDA_RNS, Int8Operands) {
+  constexpr size_t N = 16;
+  auto A = MatrixStack<N, int8_t>::generate_random(-100, 100);
+  auto B = MatrixStack<N, int8_t>::generate_random(-100, 100);
+  AssertMatrixEqual(A * B, A.multiply_cuda_rns(B));
+}
+
+TEST(MatrixStackCUDA_RNS, Int16Operands) {
+  constexpr size_t N = 15;
+  auto A = MatrixStack<N, int16_t>::generate_random(-1000, 1000);
+  auto B = MatrixStack<N, int16_t>::generate_random(-1000, 1000);
+  AssertMatrixEqual(A * B, A.multiply_cuda_rns(B));
+}
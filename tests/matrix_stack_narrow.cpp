@@ -0,0 +1,126 @@
+#include "../src/matrix_heap.hpp"
+#include "../src/matrix_stack.hpp"
+#include <gtest/gtest.h>
+#include <type_traits>
+
+template <size_t N, typename T>
+MatrixStack<N> Widen(const MatrixStack<N, T> &narrow) {
+  MatrixStack<N> wide;
+  std::copy(narrow.begin(), narrow.end(), wide.begin());
+  return wide;
+}
+
+template <size_t N>
+void AssertMatrixEqual(const MatrixStack<N> &a, const MatrixStack<N> &b) {
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = 0; j < N; ++j) {
+      ASSERT_EQ(a(i, j), b(i, j)) << "Mismatch at (" << i << "," << j << ")";
+    }
+  }
+}
+
+TEST(MatrixStackNarrow, ProductIsInt32) {
+  static_assert(std::is_same<MatrixStack<4, int8_t>::product_type,
+                             MatrixStack<4, int32_t>>::value,
+                "int8 products accumulate in int32");
+  static_assert(std::is_same<MatrixStack<4, int16_t>::product_type,
+                             MatrixStack<4, int32_t>>::value,
+                "int16 products accumulate in int32");
+  static_assert(
+      std::is_same<decltype(MatrixStack<4, int8_t>{} * MatrixStack<4, int8_t>{}),
+                   MatrixStack<4, int32_t>>::value,
+      "operator* returns the product type");
+}
+
+TEST(MatrixStackNarrow, Int8Multiply2x2) {
+  MatrixStack<2, int8_t> A{1, 2, 3, 4};
+  MatrixStack<2, int8_t> B{5, 6, 7, 8};
+  MatrixStack<2> expected{19, 22, 43, 50};
+  AssertMatrixEqual(expected, A * B);
+}
+
+TEST(MatrixStackNarrow, Int8RandomMatchesInt32) {
+  constexpr size_t N = 37;
+  auto A = MatrixStack<N, int8_t>::generate_random(-100, 100);
+  auto B = MatrixStack<N, int8_t>::generate_random(-100, 100);
+  AssertMatrixEqual(Widen(A) * Widen(B), A * B);
+}
+
+TEST(MatrixStackNarrow, Int16RandomMatchesInt32) {
+  constexpr size_t N = 64;
+  auto A = MatrixStack<N, int16_t>::generate_random(-1000, 1000);
+  auto B = MatrixStack<N, int16_t>::generate_random(-1000, 1000);
+  AssertMatrixEqual(Widen(A) * Widen(B), A * B);
+}
+
+TEST(MatrixStackNarrow, ExtremeValuesDoNotOverflowStorage) {
+  constexpr size_t N = 9;
+  MatrixStack<N, int8_t> A, B;
+  for (auto &el : A)
+    el = -128;
+  for (auto &el : B)
+    el = 127;
+  auto result = A * B;
+  for (auto el : result)
+    EXPECT_EQ(el, -128 * 127 * static_cast<int32_t>(N));
+
+  // Two int16 extremes per dot product is the most int32 can hold.
+  MatrixStack<2, int16_t> C{-32767, -32767, -32767, -32767};
+  MatrixStack<2, int16_t> D{32767, 32767, 32767, 32767};
+  auto wide = C * D;
+  for (auto el : wide)
+    EXPECT_EQ(el, -2147352578);
+}
+
+TEST(MatrixStackNarrow, SingleElement) {
+  MatrixStack<1, int16_t> A{-300};
+  MatrixStack<1, int16_t> B{200};
+  EXPECT_EQ((A * B)(0, 0), -60000);
+}
+
+TEST(MatrixStackNarrow, GenerateRandomDefaultRangeFitsStorage) {
+  auto A = MatrixStack<16, int8_t>::generate_random();
+  EXPECT_TRUE(std::any_of(A.begin(), A.end(), [](int8_t el) { return el; }));
+}
+
+TEST(MatrixHeapNarrow, Int8RandomMatchesInt32) {
+  auto A = MatrixHeap<int8_t>::generate_random(23, -100, 100);
+  auto B = MatrixHeap<int8_t>::generate_random(23, -100, 100);
+  MatrixHeap<int32_t> wide_a(23), wide_b(23);
+  std::copy(A.begin(), A.end(), wide_a.begin());
+  std::copy(B.begin(), B.end(), wide_b.begin());
+
+  auto expected = wide_a * wide_b;
+  auto result = A * B;
+  for (size_t i = 0; i < 23; ++i)
+    for (size_t j = 0; j < 23; ++j)
+      ASSERT_EQ(result(i, j), expected(i, j));
+}
+
+TEST(MatrixStackNarrow, OperandPreparedInPartsMatchesWhole) {
+  constexpr size_t N = 7;
+  auto B = MatrixStack<N, int16_t>::generate_random(-1000, 1000);
+  using Operand = RowsOperand<int16_t>;
+  std::vector<Operand::type> whole(Operand::size(N)), parts(Operand::size(N));
+  Operand::prepare(B.data(), whole.data(), N);
+  for (size_t part = 0; part < 3; ++part)
+    Operand::prepare(B.data(), parts.data(), N, part, 3);
+  EXPECT_EQ(whole, parts);
+}
+
+TEST(MatrixStackNarrow, ParallelRowsMatchesInt32) {
+  constexpr size_t N = 37;
+  auto A = MatrixStack<N, int16_t>::generate_random(-1000, 1000);
+  auto B = MatrixStack<N, int16_t>::generate_random(-1000, 1000);
+  MatrixStack<N> result;
+  multiplyParallelRowsCPU(A.data(), B.data(), result.data(), N, 4);
+  AssertMatrixEqual(Widen(A) * Widen(B), result);
+}
+
+TEST(MatrixHeapNarrow, ScalarMultiplyKeepsStorage) {
+  MatrixHeap<int8_t> A{1, -2, 3, 4};
+  MatrixHeap<int8_t> doubled = 2 * A;
+  MatrixHeap<int8_t> tripled = A * 3;
+  EXPECT_EQ(doubled(0, 1), -4);
+  EXPECT_EQ(tripled(1, 1), 12);
+}
@@ -0,0 +1,102 @@
+#include "../src/multiply_async.hpp"
+#include <gtest/gtest.h>
+
+static void AssertMatrixEqual(const MatrixHeap<int32_t> &a,
+                              const MatrixHeap<int32_t> &b) {
+  ASSERT_EQ(a.size(), b.size());
+  for (size_t i = 0; i < a.size(); ++i) {
+    for (size_t j = 0; j < a.size(); ++j) {
+      ASSERT_EQ(a(i, j), b(i, j)) << "Mismatch at (" << i << "," << j << ")";
+    }
+  }
+}
+
+TEST(MultiplyAsync, SingleRequest) {
+  MatrixHeap<int32_t> A{1, 2, 3, 4};
+  MatrixHeap<int32_t> B{5, 6, 7, 8};
+  auto result = multiply_async(A, B).get();
+  AssertMatrixEqual(MatrixHeap<int32_t>{19, 22, 43, 50}, result);
+}
+
+TEST(MultiplyAsync, SharedServicePerBackend) {
+  MatrixHeap<int32_t> A{1, 2, 3, 4};
+  MatrixHeap<int32_t> B{5, 6, 7, 8};
+  for (auto backend : {MultiplyBackend::CPU, MultiplyBackend::CUDA,
+                       MultiplyBackend::CUDA_RNS}) {
+    auto result = multiply_async(A, B, backend).get();
+    AssertMatrixEqual(MatrixHeap<int32_t>{19, 22, 43, 50}, result);
+  }
+  EXPECT_EQ(shared_multiply_service(MultiplyBackend::CPU).backend(),
+            MultiplyBackend::CPU);
+  EXPECT_NE(&shared_multiply_service(MultiplyBackend::CPU),
+            &shared_multiply_service(MultiplyBackend::CUDA));
+}
+
+TEST(MultiplyAsync, CoalescesSameShapeRequests) {
+  MultiplyServiceOptions options;
+  options.max_batch = 8;
+  options.coalesce_window = std::chrono::milliseconds(200);
+  MultiplyService service(options);
+
+  std::vector<MatrixHeap<int32_t>> expected;
+  std::vector<std::future<MatrixHeap<int32_t>>> futures;
+  for (int i = 0; i < 8; ++i) {
+    auto A = MatrixHeap<int32_t>::generate_random(12, -100, 100);
+    auto B = MatrixHeap<int32_t>::generate_random(12, -100, 100);
+    expected.push_back(A * B);
+    futures.push_back(service.submit(A, B));
+  }
+
+  for (size_t i = 0; i < futures.size(); ++i)
+    AssertMatrixEqual(expected[i], futures[i].get());
+  EXPECT_EQ(service.stats().requests, 8u);
+  EXPECT_EQ(service.stats().batches, 1u);
+}
+
+TEST(MultiplyAsync, MixedShapesFromManyClients) {
+  MultiplyService service;
+  std::vector<std::thread> clients;
+  std::vector<int> failures(6, 0);
+
+  for (size_t t = 0; t < failures.size(); ++t) {
+    clients.emplace_back([&service, &failures, t] {
+      for (int i = 0; i < 10; ++i) {
+        const size_t n = 3 + (t + i) % 4;
+        auto A = MatrixHeap<int32_t>::generate_random(n, -100, 100);
+        auto B = MatrixHeap<int32_t>::generate_random(n, -100, 100);
+        auto expected = A * B;
+        auto result = service.submit(A, B).get();
+        if (!std::equal(expected.begin(), expected.end(), result.begin()))
+          ++failures[t];
+      }
+    });
+  }
+  for (auto &client : clients)
+    client.join();
+
+  for (int failed : failures)
+    EXPECT_EQ(failed, 0);
+  EXPECT_EQ(service.stats().requests, 60u);
+}
+
+TEST(MultiplyAsync, CudaBackendWithoutGpuFallsBackToCpu) {
+  MultiplyServiceOptions options;
+  options.backend = MultiplyBackend::CUDA_RNS;
+  MultiplyService service(options);
+  if (!cudaDeviceAvailable()) {
+    EXPECT_EQ(service.backend(), MultiplyBackend::CPU);
+  }
+
+  auto A = MatrixHeap<int32_t>::generate_random(16, -100, 100);
+  auto B = MatrixHeap<int32_t>::generate_random(16, -100, 100);
+  AssertMatrixEqual(A * B, service.submit(A, B).get());
+}
+
+TEST(MultiplyAsync, DestructorCompletesPendingRequests) {
+  std::future<MatrixHeap<int32_t>> future;
+  {
+    MultiplyService service;
+    future = service.submit(MatrixHeap<int32_t>{5}, MatrixHeap<int32_t>{7});
+  }
+  EXPECT_EQ(future.get()(0, 0), 35);
+}
@@ -0,0 +1,101 @@
+#include "../src/multiply_auto.hpp"
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+static void AssertMatrixEqual(const MatrixHeap<int32_t> &a,
+                              const MatrixHeap<int32_t> &b) {
+  ASSERT_EQ(a.size(), b.size());
+  for (size_t i = 0; i < a.size(); ++i) {
+    for (size_t j = 0; j < a.size(); ++j) {
+      ASSERT_EQ(a(i, j), b(i, j)) << "Mismatch at (" << i << "," << j << ")";
+    }
+  }
+}
+
+TEST(MultiplyAuto, EveryVariantMatchesNaive) {
+  auto A = MatrixHeap<int32_t>::generate_random(37, -100, 100);
+  auto B = MatrixHeap<int32_t>::generate_random(37, -100, 100);
+  auto expected = A * B;
+
+  for (TuningEntry config : {TuningEntry{0, MultiplyVariant::Naive, 0, 1},
+                             TuningEntry{0, MultiplyVariant::Tiled, 8, 1},
+                             TuningEntry{0, MultiplyVariant::Tiled, 64, 1},
+                             TuningEntry{0, MultiplyVariant::Parallel, 16, 3}}) {
+    MatrixHeap<int32_t> result(37);
+    multiply_with(config, A.data(), B.data(), result.data(), 37);
+    AssertMatrixEqual(expected, result);
+  }
+}
+
+TEST(MultiplyAuto, LookupPicksLargestSizeNotAbove) {
+  TuningTable table({{64, MultiplyVariant::Tiled, 32, 1},
+                     {16, MultiplyVariant::Naive, 0, 1},
+                     {256, MultiplyVariant::Parallel, 64, 4}});
+
+  EXPECT_EQ(table.lookup(1).n, 16u);
+  EXPECT_EQ(table.lookup(16).n, 16u);
+  EXPECT_EQ(table.lookup(100).n, 64u);
+  EXPECT_EQ(table.lookup(4096).n, 256u);
+}
+
+TEST(MultiplyAuto, TableRoundTripsThroughFile) {
+  const std::string path =
+      "/tmp/rns_tuning_test_" + std::to_string(getpid()) + ".txt";
+  TuningTable table({{16, MultiplyVariant::Naive, 0, 1},
+                     {128, MultiplyVariant::Parallel, 32, 8}});
+  ASSERT_TRUE(table.save(path));
+
+  TuningTable loaded;
+  ASSERT_TRUE(TuningTable::load(path, loaded));
+  std::remove(path.c_str());
+
+  ASSERT_EQ(loaded.entries().size(), 2u);
+  EXPECT_EQ(loaded.lookup(200).variant, MultiplyVariant::Parallel);
+  EXPECT_EQ(loaded.lookup(200).tile, 32u);
+  EXPECT_EQ(loaded.lookup(200).threads, 8u);
+}
+
+TEST(MultiplyAuto, MissingOrMalformedFileIsRejected) {
+  TuningTable table;
+  EXPECT_FALSE(TuningTable::load("/nonexistent/rns_tuning.txt", table));
+
+  const std::string path =
+      "/tmp/rns_tuning_bad_" + std::to_string(getpid()) + ".txt";
+  {
+    std::ofstream file(path);
+    file << "64 fastest 32 1\n";
+  }
+  EXPECT_FALSE(TuningTable::load(path, table));
+  std::remove(path.c_str());
+}
+
+TEST(MultiplyAuto, TuneProducesEntryPerSize) {
+  auto table = tune_multiply({8, 32}, 1);
+  ASSERT_EQ(table.entries().size(), 2u);
+  EXPECT_EQ(table.entries()[0].n, 8u);
+  EXPECT_EQ(table.entries()[1].n, 32u);
+}
+
+TEST(MultiplyAuto, MultiplyAutoMatchesNaive) {
+  auto A = MatrixHeap<int32_t>::generate_random(70, -100, 100);
+  auto B = MatrixHeap<int32_t>::generate_random(70, -100, 100);
+  AssertMatrixEqual(A * B, multiply_auto(A, B));
+}
+
+TEST(MultiplyAuto, NarrowVariantsAccumulateInInt32) {
+  MatrixHeap<int8_t> A(8), B(8);
+  std::fill(A.begin(), A.end(), 100);
+  std::fill(B.begin(), B.end(), 100);
+  MatrixHeap<int32_t> expected(8);
+  std::fill(expected.begin(), expected.end(), 80000);
+
+  for (TuningEntry config : {TuningEntry{0, MultiplyVariant::Naive, 0, 1},
+                             TuningEntry{0, MultiplyVariant::Tiled, 4, 1},
+                             TuningEntry{0, MultiplyVariant::Parallel, 4, 3}}) {
+    MatrixHeap<int32_t> result(8);
+    multiply_with(config, A.data(), B.data(), result.data(), 8);
+    AssertMatrixEqual(expected, result);
+  }
+  AssertMatrixEqual(expected, multiply_auto(A, B));
+}